@@ -13,78 +13,784 @@
 #include <algorithm>
 #include <functional>
 #include <memory>
+#include <unordered_map>
+#include <tuple>
+#include <iterator>
+#include <fstream>
+#include <sstream>
+#include <charconv>
+#include <future>
+#include <deque>
+#include <string_view>
+#include <cstdint>
+#include <atomic>
+#include <mutex>
+#include <thread>
 #endif /* __PROGTEST__ */
 
-struct Landlot
+/// @brief Interning table of owner names, every distinct spelling and every case-folded name is stored once
+///        and handed out as a pointer that stays valid for the life of the table
+class COwnerNames
+{
+private:
+  // a deque keeps the strings in place, so the views used as keys and the handed out pointers stay valid
+  std::deque<std::string> m_names;
+  std::unordered_map<std::string_view, const std::string *> m_index;
+
+public:
+  COwnerNames() {}
+
+  COwnerNames(const COwnerNames &) = delete;
+  COwnerNames &operator=(const COwnerNames &) = delete;
+
+  const std::string *intern(std::string_view name)
+  {
+    auto it = m_index.find(name);
+    if (it != m_index.end())
+      return it->second;
+    m_names.emplace_back(name);
+    m_index.emplace(m_names.back(), &m_names.back());
+    return &m_names.back();
+  }
+
+  /// @brief Lower-cases ASCII letters the way std::tolower does in the "C" locale, any other byte is kept.
+  ///        Eight bytes at a time are folded with plain word arithmetic, the rest byte by byte.
+  static void fold(std::string_view name, std::string &folded)
+  {
+    folded.resize(name.size());
+    size_t i = 0;
+    for (; i + 8 <= name.size(); i += 8)
+    {
+      uint64_t word;
+      std::memcpy(&word, name.data() + i, 8);
+      // per byte: the low 7 bits plus 0x3f carry into the top bit from 'A' up, plus 0x25 from past 'Z' up, bytes >= 0x80 are left out
+      uint64_t low = word & 0x7f7f7f7f7f7f7f7fULL;
+      uint64_t upper = (low + 0x3f3f3f3f3f3f3f3fULL) & ~(low + 0x2525252525252525ULL) & ~word & 0x8080808080808080ULL;
+      word |= upper >> 2;
+      std::memcpy(folded.data() + i, &word, 8);
+    }
+    // the same ASCII-only rule, std::tolower would follow the current locale
+    for (; i < name.size(); ++i)
+    {
+      unsigned char c = name[i];
+      folded[i] = unsigned(c - 'A') < 26u ? c | 0x20 : c;
+    }
+  }
+};
+
+/// @brief A land lot as handed to bulkAdd
+struct LandlotRecord
 {
   std::string city;
   std::string addr;
   std::string region;
   size_t id;
   std::string owner;
-  std::string owner_lower = "";
 };
 
+/// @brief Where a land lot lies, shared by every copy of the lot
+struct LandlotLocation
+{
+  std::string city;
+  std::string addr;
+  std::string region;
+  size_t id;
+};
+
+/// @brief A land lot, never modified once a version of the register holding it is published, a change makes a new copy
+struct Landlot
+{
+  std::shared_ptr<const LandlotLocation> location;
+  // interned owner as spelled by the last newOwner, and the id of its case-folded form shared by all spellings of the owner
+  const std::string *owner = nullptr;
+  uint32_t owner_key = 0;
+  // acquisition number, orders the lots of an owner
+  size_t acquired = 0;
+};
+
+using LandlotPtr = std::shared_ptr<const Landlot>;
+
+/// @brief Nodes of CBPlusTree. The layouts do not depend on the key, so cursors over trees of the same values share one type.
+///        Nodes are immutable once they are part of a tree, a change copies the path from the root down.
+template <typename TValue>
+struct CBPlusNode
+{
+  static constexpr size_t LEAF_SIZE = 64;
+  static constexpr size_t INNER_SIZE = 32;
+  using Ptr = std::shared_ptr<const CBPlusNode>;
+
+  bool leaf;
+  // entries of a leaf, children of an inner node
+  size_t count = 0;
+  // values in the subtree
+  size_t size = 0;
+};
+
+// one spare slot so that a node can overflow before it is split
+template <typename TValue>
+struct CBPlusLeaf : CBPlusNode<TValue>
+{
+  TValue values[CBPlusNode<TValue>::LEAF_SIZE + 1];
+};
+
+// keys[i] is the leftmost value of children[i + 1] when it became the separator, only its key matters
+template <typename TValue>
+struct CBPlusInner : CBPlusNode<TValue>
+{
+  TValue keys[CBPlusNode<TValue>::INNER_SIZE];
+  typename CBPlusNode<TValue>::Ptr children[CBPlusNode<TValue>::INNER_SIZE + 1];
+};
+
+template <typename TValue, typename TKeyOf>
+class CBPlusTree;
+
+/// @brief Forward iterator over the values of a CBPlusTree in key order, the tree it walks has to be kept alive
+template <typename TValue>
+class CBPlusCursor
+{
+private:
+  using Node = CBPlusNode<TValue>;
+  using Leaf = CBPlusLeaf<TValue>;
+  using Inner = CBPlusInner<TValue>;
+
+  // inner nodes from the root down with the index of the child taken
+  std::vector<std::pair<const Inner *, size_t>> m_path;
+  // nullptr past the end
+  const Leaf *m_leaf = nullptr;
+  size_t m_pos = 0;
+
+  template <typename, typename>
+  friend class CBPlusTree;
+
+  void descend(const Node *node)
+  {
+    while (!node->leaf)
+    {
+      const Inner *inner = static_cast<const Inner *>(node);
+      m_path.emplace_back(inner, 0);
+      node = inner->children[0].get();
+    }
+    m_leaf = static_cast<const Leaf *>(node);
+    m_pos = 0;
+  }
+
+  /// @brief Moves from the end of a leaf to the start of the next non-empty one
+  void settle()
+  {
+    while (m_leaf && m_pos == m_leaf->count)
+    {
+      while (!m_path.empty() && m_path.back().second + 1 == m_path.back().first->count)
+        m_path.pop_back();
+      if (m_path.empty())
+      {
+        m_leaf = nullptr;
+        return;
+      }
+      auto &[inner, idx] = m_path.back();
+      descend(inner->children[++idx].get());
+    }
+  }
+
+public:
+  using iterator_category = std::forward_iterator_tag;
+  using value_type = TValue;
+  using difference_type = std::ptrdiff_t;
+  using pointer = const TValue *;
+  using reference = const TValue &;
+
+  CBPlusCursor() {}
+
+  bool atEnd() const
+  {
+    return !m_leaf;
+  }
+
+  const TValue &operator*() const
+  {
+    return m_leaf->values[m_pos];
+  }
+
+  CBPlusCursor &operator++()
+  {
+    ++m_pos;
+    settle();
+    return *this;
+  }
+
+  bool operator==(const CBPlusCursor &other) const
+  {
+    return m_leaf == other.m_leaf && (!m_leaf || m_pos == other.m_pos);
+  }
+};
+
+/// @brief Persistent B+-tree over values ordered by the key TKeyOf extracts from them.
+///        Values live only in the leaves, inner nodes hold the subtree sizes and values as separators,
+///        so copying a node copies no keys.
+///        A change copies the O(log n) nodes on its path and shares the rest, so copying a tree is O(1)
+///        and a copy never sees later changes of the original. Insert, erase, lookup and rank are O(log n).
+template <typename TValue, typename TKeyOf>
+class CBPlusTree
+{
+private:
+  using Node = CBPlusNode<TValue>;
+  using NodePtr = typename Node::Ptr;
+  using Leaf = CBPlusLeaf<TValue>;
+  using Inner = CBPlusInner<TValue>;
+
+  static constexpr size_t LEAF_SIZE = Node::LEAF_SIZE;
+  static constexpr size_t INNER_SIZE = Node::INNER_SIZE;
+
+  NodePtr m_root;
+  TKeyOf m_keyOf;
+
+  static std::shared_ptr<Leaf> newLeaf()
+  {
+    auto leaf = std::make_shared<Leaf>();
+    leaf->leaf = true;
+    return leaf;
+  }
+
+  static std::shared_ptr<Inner> newInner()
+  {
+    auto inner = std::make_shared<Inner>();
+    inner->leaf = false;
+    return inner;
+  }
+
+  static std::shared_ptr<Leaf> copyLeaf(const NodePtr &node)
+  {
+    return std::make_shared<Leaf>(*static_cast<const Leaf *>(node.get()));
+  }
+
+  static std::shared_ptr<Inner> copyInner(const NodePtr &node)
+  {
+    return std::make_shared<Inner>(*static_cast<const Inner *>(node.get()));
+  }
+
+  static void resize(Inner *inner)
+  {
+    inner->size = 0;
+    for (size_t i = 0; i < inner->count; ++i)
+      inner->size += inner->children[i]->size;
+  }
+
+  template <typename K>
+  size_t childIndex(const Inner *inner, const K &key) const
+  {
+    return std::upper_bound(inner->keys, inner->keys + inner->count - 1, key,
+                            [this](const K &k, const TValue &sep)
+                            { return k < m_keyOf(sep); }) -
+           inner->keys;
+  }
+
+  template <typename K>
+  size_t leafIndex(const Leaf *leaf, const K &key) const
+  {
+    return std::lower_bound(leaf->values, leaf->values + leaf->count, key,
+                            [this](const TValue &v, const K &k)
+                            { return m_keyOf(v) < k; }) -
+           leaf->values;
+  }
+
+  /// @brief Inserts into a copy of the subtree, a copy that overflows is split and its new right half returned along with its smallest key
+  /// @return false when the key is already present, nothing is copied then
+  bool insert(const NodePtr &node, const TValue &value, NodePtr &result, NodePtr &split, TValue &separator) const
+  {
+    split = nullptr;
+    if (node->leaf)
+    {
+      const Leaf *leaf = static_cast<const Leaf *>(node.get());
+      size_t pos = leafIndex(leaf, m_keyOf(value));
+      if (pos < leaf->count && !(m_keyOf(value) < m_keyOf(leaf->values[pos])))
+        return false;
+
+      auto copy = copyLeaf(node);
+      std::move_backward(copy->values + pos, copy->values + copy->count, copy->values + copy->count + 1);
+      copy->values[pos] = value;
+      copy->size = ++copy->count;
+      if (copy->count > LEAF_SIZE)
+      {
+        auto right = newLeaf();
+        size_t half = copy->count / 2;
+        std::move(copy->values + half, copy->values + copy->count, right->values);
+        right->count = right->size = copy->count - half;
+        copy->count = copy->size = half;
+        separator = right->values[0];
+        split = right;
+      }
+      result = copy;
+      return true;
+    }
+
+    const Inner *inner = static_cast<const Inner *>(node.get());
+    size_t idx = childIndex(inner, m_keyOf(value));
+    NodePtr child, childSplit;
+    TValue key;
+    if (!insert(inner->children[idx], value, child, childSplit, key))
+      return false;
+
+    auto copy = copyInner(node);
+    copy->children[idx] = child;
+    ++copy->size;
+    if (childSplit)
+    {
+      std::move_backward(copy->keys + idx, copy->keys + copy->count - 1, copy->keys + copy->count);
+      std::move_backward(copy->children + idx + 1, copy->children + copy->count, copy->children + copy->count + 1);
+      copy->keys[idx] = std::move(key);
+      copy->children[idx + 1] = childSplit;
+      if (++copy->count > INNER_SIZE)
+      {
+        auto right = newInner();
+        size_t half = copy->count / 2;
+        separator = std::move(copy->keys[half - 1]);
+        std::move(copy->keys + half, copy->keys + copy->count - 1, right->keys);
+        std::move(copy->children + half, copy->children + copy->count, right->children);
+        right->count = copy->count - half;
+        copy->count = half;
+        resize(copy.get());
+        resize(right.get());
+        split = right;
+      }
+    }
+    result = copy;
+    return true;
+  }
+
+  /// @brief Refills children[idx] of a fresh parent copy after it dropped under half, from a sibling that can spare an entry or by merging with one
+  void rebalance(Inner *parent, size_t idx) const
+  {
+    bool hasLeft = idx > 0, hasRight = idx + 1 < parent->count;
+
+    if (parent->children[idx]->leaf)
+    {
+      if (hasLeft && parent->children[idx - 1]->count > LEAF_SIZE / 2)
+      {
+        auto left = copyLeaf(parent->children[idx - 1]), leaf = copyLeaf(parent->children[idx]);
+        std::move_backward(leaf->values, leaf->values + leaf->count, leaf->values + leaf->count + 1);
+        leaf->values[0] = std::move(left->values[--left->count]);
+        leaf->size = ++leaf->count;
+        left->size = left->count;
+        parent->keys[idx - 1] = leaf->values[0];
+        parent->children[idx - 1] = left;
+        parent->children[idx] = leaf;
+        return;
+      }
+      if (hasRight && parent->children[idx + 1]->count > LEAF_SIZE / 2)
+      {
+        auto leaf = copyLeaf(parent->children[idx]), right = copyLeaf(parent->children[idx + 1]);
+        leaf->values[leaf->count++] = std::move(right->values[0]);
+        std::move(right->values + 1, right->values + right->count, right->values);
+        --right->count;
+        leaf->size = leaf->count;
+        right->size = right->count;
+        parent->keys[idx] = right->values[0];
+        parent->children[idx] = leaf;
+        parent->children[idx + 1] = right;
+        return;
+      }
+      if (!hasLeft)
+        ++idx;
+      // merge children[idx] into children[idx - 1]
+      auto left = copyLeaf(parent->children[idx - 1]);
+      const Leaf *right = static_cast<const Leaf *>(parent->children[idx].get());
+      std::copy(right->values, right->values + right->count, left->values + left->count);
+      left->count += right->count;
+      left->size = left->count;
+      parent->children[idx - 1] = left;
+    }
+    else
+    {
+      if (hasLeft && parent->children[idx - 1]->count > INNER_SIZE / 2)
+      {
+        auto left = copyInner(parent->children[idx - 1]), inner = copyInner(parent->children[idx]);
+        std::move_backward(inner->keys, inner->keys + inner->count - 1, inner->keys + inner->count);
+        std::move_backward(inner->children, inner->children + inner->count, inner->children + inner->count + 1);
+        inner->keys[0] = std::move(parent->keys[idx - 1]);
+        inner->children[0] = std::move(left->children[left->count - 1]);
+        parent->keys[idx - 1] = std::move(left->keys[left->count - 2]);
+        --left->count;
+        ++inner->count;
+        resize(left.get());
+        resize(inner.get());
+        parent->children[idx - 1] = left;
+        parent->children[idx] = inner;
+        return;
+      }
+      if (hasRight && parent->children[idx + 1]->count > INNER_SIZE / 2)
+      {
+        auto inner = copyInner(parent->children[idx]), right = copyInner(parent->children[idx + 1]);
+        inner->keys[inner->count - 1] = std::move(parent->keys[idx]);
+        inner->children[inner->count++] = std::move(right->children[0]);
+        parent->keys[idx] = std::move(right->keys[0]);
+        std::move(right->keys + 1, right->keys + right->count - 1, right->keys);
+        std::move(right->children + 1, right->children + right->count, right->children);
+        right->children[--right->count] = nullptr;
+        resize(inner.get());
+        resize(right.get());
+        parent->children[idx] = inner;
+        parent->children[idx + 1] = right;
+        return;
+      }
+      if (!hasLeft)
+        ++idx;
+      // merge children[idx] into children[idx - 1] with the separator between them
+      auto left = copyInner(parent->children[idx - 1]);
+      const Inner *right = static_cast<const Inner *>(parent->children[idx].get());
+      left->keys[left->count - 1] = std::move(parent->keys[idx - 1]);
+      std::copy(right->keys, right->keys + right->count - 1, left->keys + left->count);
+      std::copy(right->children, right->children + right->count, left->children + left->count);
+      left->count += right->count;
+      resize(left.get());
+      parent->children[idx - 1] = left;
+    }
+
+    // drop the merged right node from the parent
+    std::move(parent->keys + idx, parent->keys + parent->count - 1, parent->keys + idx - 1);
+    std::move(parent->children + idx + 1, parent->children + parent->count, parent->children + idx);
+    parent->children[--parent->count] = nullptr;
+  }
+
+  /// @brief Removes the key from a copy of the subtree
+  /// @return false when the key is not present, nothing is copied then
+  template <typename K>
+  bool erase(const NodePtr &node, const K &key, NodePtr &result) const
+  {
+    if (node->leaf)
+    {
+      const Leaf *leaf = static_cast<const Leaf *>(node.get());
+      size_t pos = leafIndex(leaf, key);
+      if (pos == leaf->count || key < m_keyOf(leaf->values[pos]))
+        return false;
+      auto copy = copyLeaf(node);
+      std::move(copy->values + pos + 1, copy->values + copy->count, copy->values + pos);
+      copy->values[--copy->count] = TValue();
+      copy->size = copy->count;
+      result = copy;
+      return true;
+    }
+
+    const Inner *inner = static_cast<const Inner *>(node.get());
+    size_t idx = childIndex(inner, key);
+    NodePtr child;
+    if (!erase(inner->children[idx], key, child))
+      return false;
+
+    auto copy = copyInner(node);
+    copy->children[idx] = child;
+    --copy->size;
+    if (child->count < (child->leaf ? LEAF_SIZE / 2 : INNER_SIZE / 2))
+      rebalance(copy.get(), idx);
+    result = copy;
+    return true;
+  }
+
+  /// @brief Puts the value in place of the one with the same key in a copy of the subtree
+  bool replace(const NodePtr &node, const TValue &value, NodePtr &result) const
+  {
+    if (node->leaf)
+    {
+      const Leaf *leaf = static_cast<const Leaf *>(node.get());
+      size_t pos = leafIndex(leaf, m_keyOf(value));
+      if (pos == leaf->count || m_keyOf(value) < m_keyOf(leaf->values[pos]))
+        return false;
+      auto copy = copyLeaf(node);
+      copy->values[pos] = value;
+      result = copy;
+      return true;
+    }
+
+    const Inner *inner = static_cast<const Inner *>(node.get());
+    size_t idx = childIndex(inner, m_keyOf(value));
+    NodePtr child;
+    if (!replace(inner->children[idx], value, child))
+      return false;
+    auto copy = copyInner(node);
+    copy->children[idx] = child;
+    result = copy;
+    return true;
+  }
+
+public:
+  using const_iterator = CBPlusCursor<TValue>;
+
+  CBPlusTree() : m_root(newLeaf()) {}
+
+  size_t size() const
+  {
+    return m_root->size;
+  }
+
+  /// @return pointer to the value with the key, nullptr when there is none; valid while this tree is neither changed nor destroyed
+  template <typename K>
+  const TValue *find(const K &key) const
+  {
+    const Node *node = m_root.get();
+    while (!node->leaf)
+    {
+      const Inner *inner = static_cast<const Inner *>(node);
+      node = inner->children[childIndex(inner, key)].get();
+    }
+    const Leaf *leaf = static_cast<const Leaf *>(node);
+    size_t pos = leafIndex(leaf, key);
+    if (pos == leaf->count || key < m_keyOf(leaf->values[pos]))
+      return nullptr;
+    return &leaf->values[pos];
+  }
+
+  /// @return number of values with keys less than key
+  template <typename K>
+  size_t rank(const K &key) const
+  {
+    size_t less = 0;
+    const Node *node = m_root.get();
+    while (!node->leaf)
+    {
+      const Inner *inner = static_cast<const Inner *>(node);
+      size_t idx = childIndex(inner, key);
+      for (size_t i = 0; i < idx; ++i)
+        less += inner->children[i]->size;
+      node = inner->children[idx].get();
+    }
+    return less + leafIndex(static_cast<const Leaf *>(node), key);
+  }
+
+  /// @return false when a value with the same key is already present
+  bool insert(const TValue &value)
+  {
+    NodePtr root, split;
+    TValue separator;
+    if (!insert(m_root, value, root, split, separator))
+      return false;
+    if (split)
+    {
+      auto inner = newInner();
+      inner->keys[0] = std::move(separator);
+      inner->children[0] = root;
+      inner->children[1] = split;
+      inner->count = 2;
+      resize(inner.get());
+      root = inner;
+    }
+    m_root = root;
+    return true;
+  }
+
+  /// @return false when no value has the key
+  template <typename K>
+  bool erase(const K &key)
+  {
+    NodePtr root;
+    if (!erase(m_root, key, root))
+      return false;
+    if (!root->leaf && root->count == 1)
+      root = static_cast<const Inner *>(root.get())->children[0];
+    m_root = root;
+    return true;
+  }
+
+  /// @return false when no value has the key of value
+  bool replace(const TValue &value)
+  {
+    NodePtr root;
+    if (!replace(m_root, value, root))
+      return false;
+    m_root = root;
+    return true;
+  }
+
+  /// @brief Replaces the contents with values sorted by strictly increasing keys, building the tree bottom-up in linear time
+  void assign(const std::vector<TValue> &sorted)
+  {
+    // nodes of the level being built along with their smallest keys
+    std::vector<std::pair<NodePtr, TValue>> level;
+    size_t leaves = std::max<size_t>(1, (sorted.size() + LEAF_SIZE - 1) / LEAF_SIZE);
+    for (size_t i = 0; i < leaves; ++i)
+    {
+      size_t from = sorted.size() * i / leaves, to = sorted.size() * (i + 1) / leaves;
+      auto leaf = newLeaf();
+      std::copy(sorted.begin() + from, sorted.begin() + to, leaf->values);
+      leaf->count = leaf->size = to - from;
+      level.emplace_back(leaf, leaf->count ? leaf->values[0] : TValue());
+    }
+
+    while (level.size() > 1)
+    {
+      std::vector<std::pair<NodePtr, TValue>> parents;
+      size_t nodes = (level.size() + INNER_SIZE - 1) / INNER_SIZE;
+      for (size_t i = 0; i < nodes; ++i)
+      {
+        size_t from = level.size() * i / nodes, to = level.size() * (i + 1) / nodes;
+        auto inner = newInner();
+        for (size_t j = from; j < to; ++j)
+        {
+          inner->children[j - from] = std::move(level[j].first);
+          if (j > from)
+            inner->keys[j - from - 1] = std::move(level[j].second);
+        }
+        inner->count = to - from;
+        resize(inner.get());
+        parents.emplace_back(inner, std::move(level[from].second));
+      }
+      level = std::move(parents);
+    }
+    m_root = level[0].first;
+  }
+
+  /// @return cursor at the first value whose key is not less than key
+  template <typename K>
+  const_iterator lowerBound(const K &key) const
+  {
+    const_iterator it;
+    const Node *node = m_root.get();
+    while (!node->leaf)
+    {
+      const Inner *inner = static_cast<const Inner *>(node);
+      size_t idx = childIndex(inner, key);
+      it.m_path.emplace_back(inner, idx);
+      node = inner->children[idx].get();
+    }
+    it.m_leaf = static_cast<const Leaf *>(node);
+    it.m_pos = leafIndex(it.m_leaf, key);
+    it.settle();
+    return it;
+  }
+
+  const_iterator begin() const
+  {
+    const_iterator it;
+    it.descend(m_root.get());
+    it.settle();
+    return it;
+  }
+
+  const_iterator end() const
+  {
+    return const_iterator();
+  }
+};
+
+/// @brief Index keys of a land lot
+struct CityAddrKey
+{
+  std::tuple<const std::string &, const std::string &> operator()(const LandlotPtr &land) const
+  {
+    return std::tie(land->location->city, land->location->addr);
+  }
+};
+
+struct RegionIdKey
+{
+  std::tuple<const std::string &, const size_t &> operator()(const LandlotPtr &land) const
+  {
+    return std::tie(land->location->region, land->location->id);
+  }
+};
+
+// the lots of an owner sit next to each other in the order of acquisition
+struct OwnerKey
+{
+  std::tuple<const uint32_t &, const size_t &> operator()(const LandlotPtr &land) const
+  {
+    return std::tie(land->owner_key, land->acquired);
+  }
+};
+
+/// @brief A case-folded owner name and its id, ids are handed out densely from 0, the empty name
+struct OwnerId
+{
+  const std::string *folded = nullptr;
+  uint32_t id = 0;
+};
+
+struct FoldedKey
+{
+  std::tuple<const std::string &> operator()(const OwnerId &owner) const
+  {
+    return std::tie(*owner.folded);
+  }
+};
+
+/// @brief One consistent state of the register, never modified once published; copying it is O(1)
+struct LandRegisterVersion
+{
+  CBPlusTree<LandlotPtr, CityAddrKey> byCityAddr;
+  CBPlusTree<LandlotPtr, RegionIdKey> byRegionId;
+  CBPlusTree<LandlotPtr, OwnerKey> byOwner;
+  // readers map a folded owner name to its id here, the owner index compares ids only
+  CBPlusTree<OwnerId, FoldedKey> ownerIds;
+};
+
+/// @brief Iterates over one version of the register, later changes of the register are not seen
 class CIterator
 {
 private:
-  const std::vector<Landlot *> m_landLots;
-  size_t m_index;
+  // keeps the walked version alive
+  std::shared_ptr<const LandRegisterVersion> m_version;
+  CBPlusCursor<LandlotPtr> m_cursor;
+  size_t m_remaining;
 
 public:
-  CIterator(const std::vector<Landlot *> &landLots) : m_landLots(landLots), m_index(0) {}
+  CIterator(std::shared_ptr<const LandRegisterVersion> version, const CBPlusCursor<LandlotPtr> &cursor, size_t remaining)
+      : m_version(std::move(version)), m_cursor(cursor), m_remaining(remaining) {}
 
   bool atEnd() const
   {
-    return m_index >= m_landLots.size();
+    return m_remaining == 0;
   }
 
   void next()
   {
-    ++m_index;
+    ++m_cursor;
+    --m_remaining;
   }
 
   std::string city() const
   {
-    return m_landLots[m_index]->city;
+    return (*m_cursor)->location->city;
   }
 
   std::string addr() const
   {
-    return m_landLots[m_index]->addr;
+    return (*m_cursor)->location->addr;
   }
 
   std::string region() const
   {
-    return m_landLots[m_index]->region;
+    return (*m_cursor)->location->region;
   }
 
   size_t id() const
   {
-    return m_landLots[m_index]->id;
+    return (*m_cursor)->location->id;
   }
 
   std::string owner() const
   {
-    return m_landLots[m_index]->owner;
+    return *(*m_cursor)->owner;
   }
 };
 
+/// @brief Readers (getOwner, count, listBy*) work on the version that is current when they start and never wait for writers.
+///        Writers are serialized, each builds the next version by path copying and publishes it with one atomic store.
 class CLandRegister
 {
 private:
-  std::vector<std::pair<std::string, std::vector<Landlot *>>> m_ownerDB;
-  std::vector<Landlot *> m_landLots_by_cityAddr;
-  std::vector<Landlot *> m_landLots_by_regionId;
+  std::atomic<std::shared_ptr<const LandRegisterVersion>> m_version;
+  // taken by writers only
+  std::mutex m_writer;
+  // writer side state
+  COwnerNames m_ownerNames;
+  const std::string *m_noOwner;
+  size_t m_acquisitions = 0;
 
 public:
   CLandRegister();
 
   ~CLandRegister();
 
-  std::vector<Landlot *> getLandlotsByCityAddr() const;
+  std::vector<LandlotPtr> getLandlotsByCityAddr() const;
 
-  std::vector<Landlot *> getLandlotsByRegId() const;
+  std::vector<LandlotPtr> getLandlotsByRegId() const;
 
   bool add(const std::string &city, const std::string &addr, const std::string &region, size_t id);
 
@@ -106,231 +812,199 @@ public:
 
   CIterator listByOwner(const std::string &owner) const;
 
+  bool bulkAdd(const std::vector<LandlotRecord> &lots);
+
+  bool loadFromFile(const std::string &fileName);
+
 private:
-  int binarySearchNewByCityAddr(const std::string &city, const std::string &addr) const;
-  int binarySearchNewByRegId(const std::string &region, size_t id) const;
-  bool binarySearchByCityAddr(const std::string &city, const std::string &addr) const;
-  bool binarySearchByRegionID(const std::string &region, size_t id) const;
-  bool unique_land(const std::string &city, const std::string &addr) const;
-  bool unique_land(const std::string &region, size_t id) const;
-  void modifyOwnerDB(const std::string &owner, Landlot *Landlot, bool operation);
-  void delByRegOwnerDB(const std::string &owner, const std::string &region, size_t id);
-  void delByCityOwnerDB(const std::string &owner, const std::string &city, const std::string &addr);
+  std::shared_ptr<const LandRegisterVersion> snapshot() const;
+  static LandlotPtr findLand(const LandRegisterVersion &version, const std::string &city, const std::string &addr);
+  static LandlotPtr findLand(const LandRegisterVersion &version, const std::string &region, size_t id);
+  bool removeLand(const LandlotPtr &land);
+  bool transferLand(const LandlotPtr &land, const std::string &owner);
+  static bool findOwner(const LandRegisterVersion &version, const std::string &owner, uint32_t &id);
+  uint32_t internOwner(LandRegisterVersion &version, const std::string &folded);
+  static std::pair<size_t, size_t> ownerRange(const LandRegisterVersion &version, uint32_t id);
+  template <typename TKeyOf, typename TTree>
+  static bool mergeUnique(const TTree &index, const std::vector<LandlotPtr> &batch, std::vector<LandlotPtr> &merged);
 };
 
 // -------------------------------------------------- //
 
-/// @brief Returns the appropriate position which a landlot should be inserted to maintain sorting
-int CLandRegister::binarySearchNewByCityAddr(const std::string &city, const std::string &addr) const
+std::shared_ptr<const LandRegisterVersion> CLandRegister::snapshot() const
 {
-  Landlot landlot{city, addr, "", 0, ""};
-  auto it = std::lower_bound(m_landLots_by_cityAddr.begin(), m_landLots_by_cityAddr.end(), &landlot,
-                             [](const Landlot *a, const Landlot *b)
-                             { return std::tie(a->city, a->addr) < std::tie(b->city, b->addr); });
-  return it - m_landLots_by_cityAddr.begin();
+  return m_version.load();
 }
 
-/// @brief Returns the appropriate position which a landlot should be inserted to maintain sorting
-int CLandRegister::binarySearchNewByRegId(const std::string &region, size_t id) const
+/// @brief findLand functions look a land lot up in the index of the given key, nullptr when it is not registered
+LandlotPtr CLandRegister::findLand(const LandRegisterVersion &version, const std::string &city, const std::string &addr)
 {
-  Landlot landlot{"", "", region, id, ""};
-  auto it = std::lower_bound(m_landLots_by_regionId.begin(), m_landLots_by_regionId.end(), &landlot,
-                             [](const Landlot *a, const Landlot *b)
-                             { return std::tie(a->region, a->id) < std::tie(b->region, b->id); });
-  return it - m_landLots_by_regionId.begin();
+  const LandlotPtr *land = version.byCityAddr.find(std::tie(city, addr));
+  return land ? *land : nullptr;
 }
 
-bool CLandRegister::binarySearchByCityAddr(const std::string &city, const std::string &addr) const
+LandlotPtr CLandRegister::findLand(const LandRegisterVersion &version, const std::string &region, size_t id)
 {
-  Landlot landlot{city, addr, "", 0, ""};
-  return std::binary_search(m_landLots_by_cityAddr.begin(), m_landLots_by_cityAddr.end(), &landlot,
-                            [](const Landlot *a, const Landlot *b)
-                            { return std::tie(a->city, a->addr) < std::tie(b->city, b->addr); });
+  const LandlotPtr *land = version.byRegionId.find(std::tie(region, id));
+  return land ? *land : nullptr;
 }
 
-bool CLandRegister::binarySearchByRegionID(const std::string &region, size_t id) const
+/// @brief Publishes a version without the land, the caller holds the writer lock
+/// @return false if the land is no longer registered
+bool CLandRegister::removeLand(const LandlotPtr &land)
 {
-  Landlot landlot{"", "", region, id, ""};
-  return std::binary_search(m_landLots_by_regionId.begin(), m_landLots_by_regionId.end(), &landlot,
-                            [](const Landlot *a, const Landlot *b)
-                            { return std::tie(a->region, a->id) < std::tie(b->region, b->id); });
+  auto version = std::make_shared<LandRegisterVersion>(*snapshot());
+  if (!land || !version->byCityAddr.erase(CityAddrKey()(land)))
+    return false;
+  version->byRegionId.erase(RegionIdKey()(land));
+  version->byOwner.erase(OwnerKey()(land));
+  m_version.store(version);
+  return true;
 }
 
-bool CLandRegister::unique_land(const std::string &city, const std::string &addr) const
+/// @brief Publishes a version where the land belongs to the owner and is the last one they acquired, the caller holds the writer lock
+/// @return false if the land is not registered or the owner (ignoring case) already owns it
+bool CLandRegister::transferLand(const LandlotPtr &land, const std::string &owner)
 {
-  return m_landLots_by_cityAddr.size() == 0 ? true : !binarySearchByCityAddr(city, addr);
+  if (!land)
+    return false;
+
+  std::string folded;
+  COwnerNames::fold(owner, folded);
+  auto version = std::make_shared<LandRegisterVersion>(*snapshot());
+  uint32_t id = internOwner(*version, folded);
+  if (id == land->owner_key)
+    return false;
+
+  auto updated = std::make_shared<Landlot>(*land);
+  updated->owner = m_ownerNames.intern(owner);
+  updated->owner_key = id;
+  updated->acquired = m_acquisitions++;
+
+  version->byCityAddr.replace(updated);
+  version->byRegionId.replace(updated);
+  version->byOwner.erase(OwnerKey()(land));
+  version->byOwner.insert(updated);
+  m_version.store(version);
+  return true;
 }
 
-bool CLandRegister::unique_land(const std::string &region, size_t id) const
+/// @brief Looks up the id of the owner, ignoring case
+/// @return false if the owner never owned a lot
+bool CLandRegister::findOwner(const LandRegisterVersion &version, const std::string &owner, uint32_t &id)
 {
-  return m_landLots_by_regionId.size() == 0 ? true : !binarySearchByRegionID(region, id);
+  std::string folded;
+  COwnerNames::fold(owner, folded);
+  const OwnerId *known = version.ownerIds.find(std::tie(folded));
+  if (!known)
+    return false;
+  id = known->id;
+  return true;
 }
 
-/// @brief Manages the m_OwnerDB vector where it maintains and keeps track of what owners acquire what lands, and stores them in order of aquisition
-/// @param operation Represents what operation should be done to the owners land vector:
-///                  true -> insert land
-///                  false -> remove land
-void CLandRegister::modifyOwnerDB(const std::string &owner, Landlot *landlot, bool operation)
+/// @brief Id of the case-folded name, a new name is added to the version being built, the caller holds the writer lock
+uint32_t CLandRegister::internOwner(LandRegisterVersion &version, const std::string &folded)
 {
-  auto pair = std::make_pair(owner, std::vector<Landlot *>{});
-  auto it = std::lower_bound(m_ownerDB.begin(), m_ownerDB.end(), pair,
-                             [](const auto &a, const auto &b)
-                             { return a.first < b.first; });
-
-  // Check if owner was found and then modify accordingly
-  if (it != m_ownerDB.end() && it->first == owner)
-  {
-    if (operation)
-      it->second.push_back(landlot);
-    else
-    {
-      it->second.erase(std::remove_if(it->second.begin(), it->second.end(),
-                                      [&](Landlot *l)
-                                      { return l->owner != it->first; }),
-                       it->second.end());
-    }
-    return;
-  }
-
-  // Owner not found
-  int index = it - m_ownerDB.begin();
-  m_ownerDB.insert(m_ownerDB.begin() + index, std::make_pair(owner, std::vector{landlot}));
-  return;
+  const OwnerId *known = version.ownerIds.find(std::tie(folded));
+  if (known)
+    return known->id;
+  OwnerId owner{m_ownerNames.intern(folded), (uint32_t)version.ownerIds.size()};
+  version.ownerIds.insert(owner);
+  return owner.id;
 }
 
-/// @brief delOwnerDB functions provide the functionality to erase a specific land from owners list, depending on which parameters are given
-void CLandRegister::delByRegOwnerDB(const std::string &owner, const std::string &region, size_t id)
+/// @brief Positions of the first and past the last lot of the owner in the owner index
+std::pair<size_t, size_t> CLandRegister::ownerRange(const LandRegisterVersion &version, uint32_t id)
 {
-
-  for (auto &[owner_, lands] : m_ownerDB)
-  {
-    if (owner_ == owner)
-    {
-      lands.erase(std::remove_if(lands.begin(), lands.end(),
-                                 [&](Landlot *l)
-                                 { return l->region == region && l->id == id; }),
-                  lands.end());
-    }
-  }
+  return {version.byOwner.rank(std::make_tuple(id, size_t(0))),
+          version.byOwner.rank(std::make_tuple(id, SIZE_MAX))};
 }
 
-void CLandRegister::delByCityOwnerDB(const std::string &owner, const std::string &city, const std::string &addr)
+/// @brief Merges lots sorted by the key of the index with the lots already in it
+/// @return false if two lots share a key
+template <typename TKeyOf, typename TTree>
+bool CLandRegister::mergeUnique(const TTree &index, const std::vector<LandlotPtr> &batch, std::vector<LandlotPtr> &merged)
 {
+  auto less = [](const LandlotPtr &a, const LandlotPtr &b)
+  { return TKeyOf()(a) < TKeyOf()(b); };
 
-  for (auto &[owner_, lands] : m_ownerDB)
-  {
-    if (owner_ == owner)
-    {
-      lands.erase(std::remove_if(lands.begin(), lands.end(),
-                                 [&](Landlot *l)
-                                 { return l->city == city && l->addr == addr; }),
-                  lands.end());
-    }
-  }
+  merged.reserve(index.size() + batch.size());
+  std::merge(index.begin(), index.end(), batch.begin(), batch.end(), std::back_inserter(merged), less);
+
+  // lots with equal keys end up next to each other
+  return std::adjacent_find(merged.begin(), merged.end(), [&](const LandlotPtr &a, const LandlotPtr &b)
+                            { return !less(a, b); }) == merged.end();
 }
 
 // -------------------------------------------------- //
 
-CLandRegister::CLandRegister() {}
-
-CLandRegister::~CLandRegister()
+CLandRegister::CLandRegister() : m_noOwner(m_ownerNames.intern(""))
 {
-  for (auto ptr : m_landLots_by_cityAddr)
-  {
-    delete ptr;
-  }
+  auto version = std::make_shared<LandRegisterVersion>();
+  internOwner(*version, "");
+  m_version.store(version);
 }
 
-std::vector<Landlot *> CLandRegister::getLandlotsByCityAddr() const
+CLandRegister::~CLandRegister() {}
+
+std::vector<LandlotPtr> CLandRegister::getLandlotsByCityAddr() const
 {
-  return m_landLots_by_cityAddr;
+  auto version = snapshot();
+  return std::vector<LandlotPtr>(version->byCityAddr.begin(), version->byCityAddr.end());
 }
 
-std::vector<Landlot *> CLandRegister::getLandlotsByRegId() const
+std::vector<LandlotPtr> CLandRegister::getLandlotsByRegId() const
 {
-  return m_landLots_by_regionId;
+  auto version = snapshot();
+  return std::vector<LandlotPtr>(version->byRegionId.begin(), version->byRegionId.end());
 }
 
 bool CLandRegister::add(const std::string &city, const std::string &addr, const std::string &region, size_t id)
 {
-  if (!unique_land(city, addr) || !unique_land(region, id))
+  std::lock_guard<std::mutex> lock(m_writer);
+  auto version = std::make_shared<LandRegisterVersion>(*snapshot());
+  if (findLand(*version, city, addr) || findLand(*version, region, id))
     return false;
 
-  Landlot *landlot = new Landlot{city, addr, region, id, ""};
-  modifyOwnerDB("", landlot, true);
-
-  if (m_landLots_by_cityAddr.size() == 0)
-  {
-    m_landLots_by_cityAddr.push_back(landlot);
-    m_landLots_by_regionId.push_back(landlot);
-    return true;
-  }
-
-  int sorted_position_cityAddr = binarySearchNewByCityAddr(city, addr);
-  int sorted_position_regionId = binarySearchNewByRegId(region, id);
-
-  auto it1 = m_landLots_by_cityAddr.begin();
-  auto it2 = m_landLots_by_regionId.begin();
-
-  m_landLots_by_cityAddr.insert(it1 + sorted_position_cityAddr, landlot);
-  m_landLots_by_regionId.insert(it2 + sorted_position_regionId, landlot);
+  auto location = std::make_shared<const LandlotLocation>(LandlotLocation{city, addr, region, id});
+  LandlotPtr landlot = std::make_shared<const Landlot>(Landlot{location, m_noOwner, 0, m_acquisitions++});
+  version->byCityAddr.insert(landlot);
+  version->byRegionId.insert(landlot);
+  version->byOwner.insert(landlot);
+  m_version.store(version);
 
   return true;
 }
 
 bool CLandRegister::del(const std::string &city, const std::string &addr)
 {
-  if (unique_land(city, addr))
-    return false;
-
-  int target_index = binarySearchNewByCityAddr(city, addr);
-  int target_index_regionId = binarySearchNewByRegId(m_landLots_by_cityAddr[target_index]->region, m_landLots_by_cityAddr[target_index]->id);
-
-  delByCityOwnerDB(m_landLots_by_cityAddr[target_index]->owner_lower, city, addr);
-
-  delete m_landLots_by_cityAddr[target_index];
-
-  m_landLots_by_cityAddr.erase(m_landLots_by_cityAddr.begin() + target_index);
-  m_landLots_by_regionId.erase(m_landLots_by_regionId.begin() + target_index_regionId);
-
-  return true;
+  std::lock_guard<std::mutex> lock(m_writer);
+  return removeLand(findLand(*snapshot(), city, addr));
 }
 
 bool CLandRegister::del(const std::string &region, size_t id)
 {
-  if (unique_land(region, id))
-    return false;
-
-  int target_index = binarySearchNewByRegId(region, id);
-  int target_index_cityAddr = binarySearchNewByCityAddr(m_landLots_by_regionId[target_index]->city, m_landLots_by_regionId[target_index]->addr);
-
-  delByRegOwnerDB(m_landLots_by_regionId[target_index]->owner_lower, region, id);
-
-  delete m_landLots_by_regionId[target_index];
-
-  m_landLots_by_regionId.erase(m_landLots_by_regionId.begin() + target_index);
-  m_landLots_by_cityAddr.erase(m_landLots_by_cityAddr.begin() + target_index_cityAddr);
-
-  return true;
+  std::lock_guard<std::mutex> lock(m_writer);
+  return removeLand(findLand(*snapshot(), region, id));
 }
 
 bool CLandRegister::getOwner(const std::string &city, const std::string &addr, std::string &owner) const
 {
-  if (unique_land(city, addr))
+  LandlotPtr land = findLand(*snapshot(), city, addr);
+  if (!land)
     return false;
 
-  int target_index = binarySearchNewByCityAddr(city, addr);
-  owner = m_landLots_by_cityAddr[target_index]->owner;
+  owner = *land->owner;
   return true;
 }
 
 bool CLandRegister::getOwner(const std::string &region, size_t id, std::string &owner) const
 {
-  if (unique_land(region, id))
+  LandlotPtr land = findLand(*snapshot(), region, id);
+  if (!land)
     return false;
 
-  int target_index = binarySearchNewByRegId(region, id);
-  owner = m_landLots_by_regionId[target_index]->owner;
+  owner = *land->owner;
   return true;
 }
 
@@ -341,71 +1015,25 @@ bool CLandRegister::getOwner(const std::string &region, size_t id, std::string &
 ///         the owner already owns the land lot). If the method fails, the register is not modified in any way
 bool CLandRegister::newOwner(const std::string &city, const std::string &addr, const std::string &owner)
 {
-  if (unique_land(city, addr))
-    return false;
-
-  int target_index = binarySearchNewByCityAddr(city, addr);
-  std::string prev_owner = m_landLots_by_cityAddr[target_index]->owner_lower;
-
-  std::string owner_lower = owner;
-  std::transform(owner_lower.begin(), owner_lower.end(), owner_lower.begin(),
-                 [](unsigned char c)
-                 { return std::tolower(c); });
-
-  if (prev_owner == owner_lower)
-    return false;
-
-  Landlot *land = m_landLots_by_cityAddr[target_index];
-  land->owner = owner;
-  land->owner_lower = owner_lower;
-
-  modifyOwnerDB(prev_owner, land, false);
-  modifyOwnerDB(owner_lower, land, true);
-  return true;
+  std::lock_guard<std::mutex> lock(m_writer);
+  return transferLand(findLand(*snapshot(), city, addr), owner);
 }
 
 bool CLandRegister::newOwner(const std::string &region, size_t id, const std::string &owner)
 {
-  if (unique_land(region, id))
-    return false;
-
-  int target_index = binarySearchNewByRegId(region, id);
-  std::string prev_owner = m_landLots_by_regionId[target_index]->owner_lower;
-
-  std::string owner_lower = owner;
-  std::transform(owner_lower.begin(), owner_lower.end(), owner_lower.begin(),
-                 [](unsigned char c)
-                 { return std::tolower(c); });
-
-  if (prev_owner == owner_lower)
-    return false;
-
-  Landlot *land = m_landLots_by_regionId[target_index];
-  land->owner = owner;
-  land->owner_lower = owner_lower;
-
-  modifyOwnerDB(prev_owner, land, false);
-  modifyOwnerDB(owner_lower, land, true);
-  return true;
+  std::lock_guard<std::mutex> lock(m_writer);
+  return transferLand(findLand(*snapshot(), region, id), owner);
 }
 
 size_t CLandRegister::count(const std::string &owner) const
 {
-  std::string owner_lower = owner;
-  std::transform(owner_lower.begin(), owner_lower.end(), owner_lower.begin(),
-                 [](unsigned char c)
-                 { return std::tolower(c); });
-
-  auto pair = std::make_pair(owner_lower, 0);
-  auto it = std::lower_bound(m_ownerDB.begin(), m_ownerDB.end(), pair,
-                             [](const auto &a, const auto &b)
-                             { return a.first < b.first; });
+  auto version = snapshot();
+  uint32_t id;
+  if (!findOwner(*version, owner, id))
+    return 0;
 
-  if (it != m_ownerDB.end() && it->first == owner_lower)
-    return it->second.size();
-
-  // Owner not found
-  return 0;
+  auto [first, last] = ownerRange(*version, id);
+  return last - first;
 }
 
 /// @brief returns an iterator object (see below), to iterate through the list of all land lots in the register.
@@ -413,33 +1041,147 @@ size_t CLandRegister::count(const std::string &owner) const
 ///        the sort key is the name of the city and (if the city is the same) the address.
 CIterator CLandRegister::listByAddr() const
 {
-  return CIterator(m_landLots_by_cityAddr);
+  auto version = snapshot();
+  auto cursor = version->byCityAddr.begin();
+  size_t size = version->byCityAddr.size();
+  return CIterator(std::move(version), cursor, size);
 }
 
 /// @brief returns an iterator object see (below), to iterate through the list of land lots owned by the owner from the parameter.
 ///        The iterator must list the land lots in the order the owner bought them (i.e., in the order the owner registered them in our register).
 CIterator CLandRegister::listByOwner(const std::string &owner) const
 {
+  auto version = snapshot();
+  uint32_t id;
+  if (!findOwner(*version, owner, id))
+    return CIterator(std::move(version), CBPlusCursor<LandlotPtr>(), 0);
+
+  auto [first, last] = ownerRange(*version, id);
+  auto cursor = version->byOwner.lowerBound(std::make_tuple(id, size_t(0)));
+  return CIterator(std::move(version), cursor, last - first);
+}
 
-  std::string owner_lower = owner;
-  std::transform(owner_lower.begin(), owner_lower.end(), owner_lower.begin(),
-                 [](unsigned char c)
-                 { return std::tolower(c); });
+/// @brief Registers a whole batch of land lots at once. The batch is sorted once per key, both sorts running in parallel,
+///        and checked for clashes by merging it with the register, the indices are then rebuilt from the merged runs in linear time.
+///        A batch much smaller than the register is inserted lot by lot instead.
+///        Lots that come with an owner count as acquired by them in the order of the batch.
+/// @return false if a lot clashes with another lot of the batch or of the register, the register is then not modified
+bool CLandRegister::bulkAdd(const std::vector<LandlotRecord> &lots)
+{
+  std::lock_guard<std::mutex> lock(m_writer);
+  auto version = std::make_shared<LandRegisterVersion>(*snapshot());
 
-  std::vector<Landlot *> ownerLots;
+  std::vector<std::shared_ptr<Landlot>> batch;
+  std::vector<LandlotPtr> byCityAddr, byRegionId;
+  batch.reserve(lots.size());
+  for (const LandlotRecord &lot : lots)
+  {
+    auto location = std::make_shared<const LandlotLocation>(LandlotLocation{lot.city, lot.addr, lot.region, lot.id});
+    batch.push_back(std::make_shared<Landlot>(Landlot{location}));
+    byCityAddr.push_back(batch.back());
+  }
+  byRegionId = byCityAddr;
+
+  auto sortRegionId = std::async(std::launch::async, [&byRegionId]()
+                                 { std::sort(byRegionId.begin(), byRegionId.end(), [](const LandlotPtr &a, const LandlotPtr &b)
+                                             { return RegionIdKey()(a) < RegionIdKey()(b); }); });
+  std::sort(byCityAddr.begin(), byCityAddr.end(), [](const LandlotPtr &a, const LandlotPtr &b)
+            { return CityAddrKey()(a) < CityAddrKey()(b); });
+  sortRegionId.get();
+
+  bool small = batch.size() * 8 < version->byCityAddr.size();
+  std::vector<LandlotPtr> mergedCityAddr, mergedRegionId;
+  if (small)
+  {
+    auto clash = [](const auto &sorted, auto keyOf)
+    {
+      return std::adjacent_find(sorted.begin(), sorted.end(), [&](const LandlotPtr &a, const LandlotPtr &b)
+                                { return !(keyOf(a) < keyOf(b)); }) != sorted.end();
+    };
+    if (clash(byCityAddr, CityAddrKey()) || clash(byRegionId, RegionIdKey()))
+      return false;
+    for (const auto &land : batch)
+    {
+      const LandlotLocation &location = *land->location;
+      if (findLand(*version, location.city, location.addr) || findLand(*version, location.region, location.id))
+        return false;
+    }
+  }
+  else if (!mergeUnique<CityAddrKey>(version->byCityAddr, byCityAddr, mergedCityAddr) ||
+           !mergeUnique<RegionIdKey>(version->byRegionId, byRegionId, mergedRegionId))
+    return false;
 
-  for (auto &[owner, lands] : m_ownerDB)
+  // names are interned only now that the batch is known to go in
+  std::string folded;
+  for (size_t i = 0; i < batch.size(); ++i)
   {
-    if (owner == owner_lower)
+    COwnerNames::fold(lots[i].owner, folded);
+    batch[i]->owner = m_ownerNames.intern(lots[i].owner);
+    batch[i]->owner_key = internOwner(*version, folded);
+    batch[i]->acquired = m_acquisitions++;
+  }
+
+  if (small)
+  {
+    for (const auto &land : batch)
     {
-      ownerLots = lands;
-      break;
+      version->byCityAddr.insert(land);
+      version->byRegionId.insert(land);
+      version->byOwner.insert(land);
     }
   }
-  return CIterator(ownerLots);
+  else
+  {
+    std::vector<LandlotPtr> byOwner(batch.begin(), batch.end()), mergedOwner;
+    std::sort(byOwner.begin(), byOwner.end(), [](const LandlotPtr &a, const LandlotPtr &b)
+              { return OwnerKey()(a) < OwnerKey()(b); });
+    mergeUnique<OwnerKey>(version->byOwner, byOwner, mergedOwner);
+
+    version->byCityAddr.assign(mergedCityAddr);
+    version->byRegionId.assign(mergedRegionId);
+    version->byOwner.assign(mergedOwner);
+  }
+
+  m_version.store(version);
+  return true;
+}
+
+/// @brief Registers the land lots listed in a file, one lot per line as tab separated city, address, region, id and an optional owner.
+/// @return false if the file can not be read, a line is malformed or the lots can not be added (see bulkAdd), the register is then not modified
+bool CLandRegister::loadFromFile(const std::string &fileName)
+{
+  std::ifstream in(fileName);
+  if (!in)
+    return false;
+
+  std::vector<LandlotRecord> lots;
+  std::string line;
+  while (std::getline(in, line))
+  {
+    // files written on Windows end their lines with CRLF
+    if (!line.empty() && line.back() == '\r')
+      line.pop_back();
+    if (line.empty())
+      continue;
+
+    std::istringstream fields(line);
+    LandlotRecord lot{};
+    std::string id;
+    if (!std::getline(fields, lot.city, '\t') || !std::getline(fields, lot.addr, '\t') ||
+        !std::getline(fields, lot.region, '\t') || !std::getline(fields, id, '\t'))
+      return false;
+    std::getline(fields, lot.owner);
+    if (lot.owner.find('\t') != std::string::npos)
+      return false;
+
+    auto [end, error] = std::from_chars(id.data(), id.data() + id.size(), lot.id);
+    if (id.empty() || error != std::errc() || end != id.data() + id.size())
+      return false;
+    lots.push_back(std::move(lot));
+  }
+  return !in.bad() && bulkAdd(lots);
 }
 
-// -------------------------------------------------- //
 #ifndef __PROGTEST__
 static void test0()
 {
@@ -585,10 +1327,231 @@ static void test1()
   assert(!x.del("Dejvice", 9873));
 }
 
+static void test2()
+{
+  CLandRegister x;
+
+  assert(x.add("Brno", "Kounicova", "Veveri", 1));
+  assert(x.add("Brno", "Botanicka", "Veveri", 2));
+  assert(x.add("Brno", "Purkynova", "Medlanky", 3));
+  assert(x.add("Brno", "Kolejni", "Medlanky", 4));
+  assert(x.newOwner("Veveri", 1, "MUNI"));
+  assert(x.newOwner("Veveri", 2, "muni"));
+  assert(x.newOwner("Medlanky", 3, "Muni"));
+  assert(x.newOwner("Medlanky", 4, "VUT"));
+  assert(x.count("") == 0);
+
+  // a lot acquired again goes to the end of the list
+  assert(x.newOwner("Brno", "Botanicka", "VUT"));
+  assert(x.newOwner("Brno", "Botanicka", "MUNI"));
+  assert(!x.newOwner("Brno", "Botanicka", "Muni"));
+  assert(x.count("muni") == 3 && x.count("vut") == 1);
+  CIterator i0 = x.listByOwner("MUNI");
+  assert(!i0.atEnd() && i0.id() == 1);
+  i0.next();
+  assert(!i0.atEnd() && i0.id() == 3 && i0.owner() == "Muni");
+  i0.next();
+  assert(!i0.atEnd() && i0.id() == 2 && i0.owner() == "MUNI");
+  i0.next();
+  assert(i0.atEnd());
+
+  // removing from the middle and the end keeps the rest in order
+  assert(x.del("Medlanky", 3));
+  assert(x.del("Brno", "Botanicka"));
+  assert(x.count("muni") == 1);
+  CIterator i1 = x.listByOwner("muni");
+  assert(!i1.atEnd() && i1.id() == 1);
+  i1.next();
+  assert(i1.atEnd());
+  assert(x.del("Veveri", 1));
+  assert(x.count("muni") == 0 && x.listByOwner("muni").atEnd());
+  assert(x.add("Brno", "Botanicka", "Veveri", 2));
+  assert(x.count("") == 1 && x.count("vut") == 1);
+}
+
+static void test3()
+{
+  CLandRegister x;
+  std::string owner;
+
+  // enough lots for a few levels of the index, added out of order
+  for (size_t i = 0; i < 5000; ++i)
+  {
+    size_t k = i * 7919 % 5000;
+    assert(x.add("City" + std::to_string(k % 7), "Street " + std::to_string(k), "Region" + std::to_string(k % 3), k));
+  }
+  for (size_t k = 0; k < 5000; k += 2)
+    assert(x.del("Region" + std::to_string(k % 3), k));
+  assert(!x.del("Region0", 0) && x.count("") == 2500);
+  assert(x.getOwner("City1", "Street 1", owner) && owner == "");
+  assert(!x.getOwner("City2", "Street 2", owner));
+
+  CIterator i0 = x.listByAddr();
+  std::string prevCity, prevAddr;
+  size_t listed = 0;
+  for (; !i0.atEnd(); i0.next(), ++listed)
+  {
+    assert(i0.id() % 2 == 1 && i0.city() == "City" + std::to_string(i0.id() % 7));
+    assert(std::make_tuple(prevCity, prevAddr) < std::make_tuple(i0.city(), i0.addr()));
+    prevCity = i0.city();
+    prevAddr = i0.addr();
+  }
+  assert(listed == 2500);
+}
+
+static void test4()
+{
+  CLandRegister x;
+  std::string owner;
+
+  std::vector<LandlotRecord> lots;
+  for (size_t i = 0; i < 1000; ++i)
+    lots.push_back(LandlotRecord{"Ostrava", "Street " + std::to_string(999 - i), "Poruba", i, i % 2 ? "VSB" : ""});
+  assert(x.bulkAdd(lots));
+  assert(x.count("vsb") == 500 && x.count("") == 500);
+  CIterator i0 = x.listByOwner("VSB");
+  assert(!i0.atEnd() && i0.id() == 1);
+  i0.next();
+  assert(!i0.atEnd() && i0.id() == 3);
+  CIterator i1 = x.listByAddr();
+  assert(!i1.atEnd() && i1.addr() == "Street 0" && i1.id() == 999);
+
+  // clashes inside the batch or with the register leave the register as it was
+  assert(!x.bulkAdd({LandlotRecord{"Opava", "Masarykova", "Opava", 1, ""}, LandlotRecord{"Opava", "Masarykova", "Opava", 2, ""}}));
+  assert(!x.bulkAdd({LandlotRecord{"Opava", "Masarykova", "Opava", 1, ""}, LandlotRecord{"Opava", "Nadrazni", "Poruba", 7, ""}}));
+  assert(!x.getOwner("Opava", "Masarykova", owner));
+
+  // a small batch goes in lot by lot
+  assert(x.bulkAdd({LandlotRecord{"Opava", "Nadrazni", "Opava", 1, "Anna"}, LandlotRecord{"Opava", "Masarykova", "Opava", 2, "ANNA"}}));
+  assert(x.count("anna") == 2 && x.getOwner("Opava", 2, owner) && owner == "ANNA");
+  assert(x.add("Ostrava", "Street 1000", "Poruba", 1000));
+  assert(x.del("Ostrava", "Street 0") && x.del("Poruba", 998));
+
+  {
+    std::ofstream out("landlots.tsv");
+    out << "Zlin\tNamesti Miru\tZlin\t12\tUTB\n"
+        << "Zlin\tTrida Tomase Bati\tZlin\t13\n";
+  }
+  assert(x.loadFromFile("landlots.tsv"));
+  assert(x.getOwner("Zlin", 12, owner) && owner == "UTB");
+  assert(x.getOwner("Zlin", "Trida Tomase Bati", owner) && owner == "");
+  assert(!x.loadFromFile("landlots.tsv"));
+  {
+    std::ofstream out("landlots.tsv");
+    out << "Zlin\tPodvesna\tZlin\tx14\n";
+  }
+  assert(!x.loadFromFile("landlots.tsv") && !x.loadFromFile("missing.tsv"));
+  {
+    std::ofstream out("landlots.tsv");
+    out << "Zlin\tPodvesna\tZlin\t14\tUTB\tjunk\n";
+  }
+  assert(!x.loadFromFile("landlots.tsv") && !x.getOwner("Zlin", 14, owner));
+  {
+    std::ofstream out("landlots.tsv", std::ios::binary);
+    out << "Zlin\tPodvesna\tZlin\t14\tUTB\r\n\r\n"
+        << "Zlin\tMostni\tZlin\t15\r\n";
+  }
+  assert(x.loadFromFile("landlots.tsv") && x.count("utb") == 2);
+  assert(x.getOwner("Zlin", 14, owner) && owner == "UTB");
+  assert(x.getOwner("Zlin", "Mostni", owner) && owner == "");
+  std::remove("landlots.tsv");
+}
+
+static void test5()
+{
+  CLandRegister x;
+  std::string owner, folded;
+
+  COwnerNames::fold("Ceske Vysoke Uceni Technicke @[`{ 09", folded);
+  assert(folded == "ceske vysoke uceni technicke @[`{ 09");
+  COwnerNames::fold("\xc5\xbdLU\xc5\xa4OU\xc4\x8cK\xc3\x9d K\xc5\xae\xc5\x87", folded);
+  assert(folded == "\xc5\xbdlu\xc5\xa4ou\xc4\x8ck\xc3\x9d k\xc5\xae\xc5\x87");
+  COwnerNames::fold("\xc0\xc0\xc0\xc0\xc0\xc0\xc0\xc0\xc0Z", folded);
+  assert(folded == "\xc0\xc0\xc0\xc0\xc0\xc0\xc0\xc0\xc0z");
+
+  assert(x.add("Praha", "Jugoslavskych partyzanu", "Dejvice", 1));
+  assert(x.add("Praha", "Karlovo namesti", "Nove Mesto", 2));
+  assert(x.newOwner("Dejvice", 1, "Ceske Vysoke Uceni Technicke"));
+  assert(x.newOwner("Nove Mesto", 2, "CESKE VYSOKE UCENI TECHNICKE"));
+  assert(!x.newOwner("Nove Mesto", 2, "ceske vysoke uceni technicke"));
+  assert(x.count("ceske VYSOKE uceni technicke") == 2);
+  assert(x.getOwner("Praha", "Jugoslavskych partyzanu", owner) && owner == "Ceske Vysoke Uceni Technicke");
+  assert(x.getOwner("Nove Mesto", 2, owner) && owner == "CESKE VYSOKE UCENI TECHNICKE");
+
+  // only ASCII letters fold, other bytes have to match exactly
+  assert(x.newOwner("Dejvice", 1, "\xc5\xbdofie"));
+  assert(x.count("\xc5\xbdOFIE") == 1 && x.count("\xc5\xbeofie") == 0);
+  CIterator i0 = x.listByOwner("\xc5\xbdOFIe");
+  assert(!i0.atEnd() && i0.id() == 1 && i0.owner() == "\xc5\xbdofie");
+  i0.next();
+  assert(i0.atEnd());
+}
+
+static void test6()
+{
+  CLandRegister x;
+  std::string owner;
+
+  for (size_t i = 0; i < 200; ++i)
+    assert(x.add("Plzen", "Street " + std::to_string(i), "Bory", i));
+  assert(x.newOwner("Bory", 0, "ZCU") && x.newOwner("Bory", 1, "ZCU"));
+
+  // an iterator keeps listing the register as it was when it was created
+  CIterator i0 = x.listByOwner("zcu");
+  CIterator i1 = x.listByAddr();
+  assert(x.newOwner("Bory", 0, "Skoda") && x.del("Bory", 1) && x.add("Plzen", "Americka", "Bory", 500));
+  assert(x.count("zcu") == 0 && x.count("skoda") == 1);
+  assert(!i0.atEnd() && i0.id() == 0 && i0.owner() == "ZCU");
+  i0.next();
+  assert(!i0.atEnd() && i0.id() == 1);
+  i0.next();
+  assert(i0.atEnd());
+  assert(!i1.atEnd() && i1.addr() == "Street 0" && i1.owner() == "ZCU");
+  size_t listed = 0;
+  for (; !i1.atEnd(); i1.next())
+    ++listed;
+  assert(listed == 200);
+
+  // readers run alongside a writer moving lots between two owners, every lot is owned by exactly one of them at any time
+  for (size_t i = 0; i < 200; ++i)
+    x.newOwner("Plzen", "Street " + std::to_string(i), "A");
+  std::atomic<bool> done = false;
+  std::thread writer([&x, &done]()
+                     {
+                       for (size_t round = 0; round < 20; ++round)
+                         for (size_t i = 2; i < 200; ++i)
+                           assert(x.newOwner("Bory", i, round % 2 ? "A" : "B"));
+                       done = true; });
+  std::vector<std::thread> readers;
+  for (size_t r = 0; r < 2; ++r)
+    readers.emplace_back([&x, &done]()
+                         {
+                           std::string owner;
+                           do
+                           {
+                             size_t listed = 0, owned = 0;
+                             for (CIterator i = x.listByAddr(); !i.atEnd(); i.next(), ++listed)
+                               owned += i.owner() == "A" || i.owner() == "B";
+                             assert(listed == 200 && owned == 199);
+                             for (CIterator i = x.listByOwner("b"); !i.atEnd(); i.next())
+                               assert(i.owner() == "B");
+                             assert(x.getOwner("Bory", 100, owner) && (owner == "A" || owner == "B"));
+                           } while (!done); });
+  writer.join();
+  for (std::thread &reader : readers)
+    reader.join();
+  assert(x.count("a") == 199 && x.count("b") == 0);
+}
+
 int main(void)
 {
   test0();
   test1();
+  test2();
+  test3();
+  test4();
+  test5();
+  test6();
   return EXIT_SUCCESS;
 }
 #endif /* __PROGTEST__ */
@@ -12,6 +12,10 @@
 #include <sstream>
 #include <string>
 #include <vector>
+#include <deque>
+#include <thread>
+#include <future>
+#include <mutex>
 #include <algorithm>
 #include <memory>
 #include <functional>
@@ -24,457 +28,1764 @@ using namespace std;
 class CBigInt
 {
 public:
+  using limb_t = uint64_t;
+  using dlimb_t = unsigned __int128;
+
+  // below these operand sizes (in limbs) the simpler algorithm wins
+  static constexpr size_t KARATSUBA_THRESHOLD = 32;
+  static constexpr size_t TOOM3_THRESHOLD = 192;
+  static constexpr size_t CONVERSION_THRESHOLD = 64;
+  static constexpr size_t RECIPROCAL_THRESHOLD = 64;
+  // smallest Toom-3 split (in limbs) worth handing to another thread
+  static constexpr size_t PARALLEL_THRESHOLD = 1024;
+
+  // decimal digits that always fit into one limb
+  static constexpr size_t CHUNK_DIGITS = 19;
+  static constexpr limb_t CHUNK_BASE = 10000000000000000000ULL;
+
+  // values up to this many limbs are stored inline without touching the heap
+  static constexpr size_t INLINE_LIMBS = 2;
+
+  // vector of limbs with inline storage for small values, spills to the heap when it outgrows it
+  class CLimbs
+  {
+  public:
+    CLimbs() {}
+
+    CLimbs(const CLimbs &other)
+    {
+      assign(other.begin(), other.end());
+    }
+
+    CLimbs(CLimbs &&other) noexcept
+    {
+      steal(other);
+    }
+
+    CLimbs &operator=(const CLimbs &other)
+    {
+      if (this != &other)
+        assign(other.begin(), other.end());
+      return *this;
+    }
+
+    CLimbs &operator=(CLimbs &&other) noexcept
+    {
+      if (this != &other)
+      {
+        release();
+        steal(other);
+      }
+      return *this;
+    }
+
+    ~CLimbs()
+    {
+      release();
+    }
+
+    size_t size() const { return this->count; }
+    size_t capacity() const { return this->cap; }
+    bool empty() const { return this->count == 0; }
+    bool isInline() const { return this->ptr == this->local; }
+
+    limb_t *data() { return this->ptr; }
+    const limb_t *data() const { return this->ptr; }
+    limb_t *begin() { return this->ptr; }
+    const limb_t *begin() const { return this->ptr; }
+    limb_t *end() { return this->ptr + this->count; }
+    const limb_t *end() const { return this->ptr + this->count; }
+
+    limb_t &operator[](size_t i) { return this->ptr[i]; }
+    const limb_t &operator[](size_t i) const { return this->ptr[i]; }
+    limb_t &back() { return this->ptr[this->count - 1]; }
+    const limb_t &back() const { return this->ptr[this->count - 1]; }
+
+    void reserve(size_t size)
+    {
+      if (size <= this->cap)
+        return;
+
+      size_t cap = std::max(size, 2 * this->cap);
+      limb_t *grown = new limb_t[cap];
+
+      std::copy(this->ptr, this->ptr + this->count, grown);
+      release();
+      this->ptr = grown;
+      this->cap = cap;
+    }
+
+    void resize(size_t size, limb_t value = 0)
+    {
+      reserve(size);
+
+      if (size > this->count)
+        std::fill(this->ptr + this->count, this->ptr + size, value);
+
+      this->count = size;
+    }
+
+    void assign(const limb_t *first, const limb_t *last)
+    {
+      size_t size = last - first;
+
+      if (size > this->cap)
+      {
+        this->count = 0;
+        reserve(size);
+      }
+
+      std::copy(first, last, this->ptr);
+      this->count = size;
+    }
+
+    void assign(size_t size, limb_t value)
+    {
+      this->count = 0;
+      resize(size, value);
+    }
+
+    void push_back(limb_t value)
+    {
+      if (this->count == this->cap)
+        reserve(this->count + 1);
+
+      this->ptr[this->count++] = value;
+    }
+
+    void pop_back() { this->count--; }
+    void clear() { this->count = 0; }
+
+    limb_t *insert(limb_t *pos, size_t n, limb_t value)
+    {
+      size_t index = pos - this->ptr;
+
+      reserve(this->count + n);
+      std::copy_backward(this->ptr + index, this->ptr + this->count, this->ptr + this->count + n);
+      std::fill(this->ptr + index, this->ptr + index + n, value);
+      this->count += n;
+
+      return this->ptr + index;
+    }
+
+    limb_t *erase(limb_t *first, limb_t *last)
+    {
+      std::copy(last, end(), first);
+      this->count -= last - first;
+
+      return first;
+    }
+
+    void swap(CLimbs &other) noexcept
+    {
+      if (!isInline() && !other.isInline())
+      {
+        std::swap(this->ptr, other.ptr);
+        std::swap(this->count, other.count);
+        std::swap(this->cap, other.cap);
+        return;
+      }
+
+      CLimbs temp(std::move(other));
+      other = std::move(*this);
+      *this = std::move(temp);
+    }
+
+    friend bool operator==(const CLimbs &first, const CLimbs &second)
+    {
+      return first.count == second.count && std::equal(first.begin(), first.end(), second.begin());
+    }
+
+  private:
+    limb_t *ptr = local;
+    size_t count = 0;
+    size_t cap = INLINE_LIMBS;
+    limb_t local[INLINE_LIMBS];
+
+    void release()
+    {
+      if (!isInline())
+        delete[] this->ptr;
+
+      this->ptr = this->local;
+      this->cap = INLINE_LIMBS;
+    }
+
+    // takes over the storage of other and leaves it empty
+    void steal(CLimbs &other)
+    {
+      this->count = other.count;
+
+      if (other.isInline())
+      {
+        std::copy(other.local, other.local + other.count, this->local);
+        this->ptr = this->local;
+        this->cap = INLINE_LIMBS;
+      }
+      else
+      {
+        this->ptr = other.ptr;
+        this->cap = other.cap;
+        other.ptr = other.local;
+        other.cap = INLINE_LIMBS;
+      }
+
+      other.count = 0;
+    }
+  };
+
   bool neg = false;
-  std::string number = "0";
+  // magnitude in base 2^64, least significant limb first, no leading zero limbs (empty == 0)
+  CLimbs limbs;
 
   CBigInt() {}
 
-  CBigInt(const CBigInt &other)
+  CBigInt(const CBigInt &other) = default;
+
+  CBigInt(CBigInt &&other) noexcept
+      : neg(other.neg), limbs(std::move(other.limbs))
+  {
+    other.neg = false;
+  }
+
+  CBigInt &operator=(const CBigInt &other)
+  {
+    if (this != &other)
+    {
+      this->neg = other.neg;
+      this->limbs.assign(other.limbs.begin(), other.limbs.end());
+    }
+    return *this;
+  }
+
+  CBigInt &operator=(CBigInt &&other) noexcept
+  {
+    if (this != &other)
+    {
+      this->neg = other.neg;
+      this->limbs.swap(other.limbs);
+      other.neg = false;
+      other.limbs.clear();
+    }
+    return *this;
+  }
+
+  CBigInt(int number) : CBigInt((long long)number) {}
+
+  CBigInt(long number) : CBigInt((long long)number) {}
+
+  CBigInt(long long number)
+  {
+    limb_t magnitude = number < 0 ? -(limb_t)number : (limb_t)number;
+
+    if (magnitude != 0)
+    {
+      this->limbs.push_back(magnitude);
+      this->neg = number < 0;
+    }
+  }
+
+  CBigInt(unsigned number) : CBigInt((unsigned long long)number) {}
+
+  CBigInt(unsigned long number) : CBigInt((unsigned long long)number) {}
+
+  CBigInt(unsigned long long number)
+  {
+    if (number != 0)
+      this->limbs.push_back(number);
+  }
+
+  CBigInt(const char *number)
+  {
+    assignDecimal(number, strlen(number));
+  }
+
+  CBigInt(const std::string &number)
+  {
+    assignDecimal(number.data(), number.size());
+  }
+
+  friend bool operator==(const CBigInt &first, const CBigInt &second)
+  {
+    return first.neg == second.neg && first.limbs == second.limbs;
+  }
+
+  friend bool operator!=(const CBigInt &first, const CBigInt &second)
+  {
+    return !(first == second);
+  }
+
+  friend bool operator<(const CBigInt &first, const CBigInt &second)
+  {
+    return compare(first, second) < 0;
+  }
+
+  friend bool operator<=(const CBigInt &first, const CBigInt &second)
+  {
+    return compare(first, second) <= 0;
+  }
+
+  friend bool operator>(const CBigInt &first, const CBigInt &second)
+  {
+    return compare(first, second) > 0;
+  }
+
+  friend bool operator>=(const CBigInt &first, const CBigInt &second)
+  {
+    return compare(first, second) >= 0;
+  }
+
+  // reads digits straight from the stream buffer, stops at the first non-digit
+  friend std::istream &operator>>(std::istream &in, CBigInt &CBigInt)
+  {
+    std::istream::sentry sentry(in);
+
+    if (!sentry)
+      return in;
+
+    typedef std::istream::traits_type traits;
+    std::streambuf *buffer = in.rdbuf();
+    int c = buffer->sgetc();
+
+    if (c == traits::eof() || !std::isdigit(c))
+    {
+      in.setstate(c == traits::eof() ? ios::failbit | ios::eofbit : ios::failbit);
+      return in;
+    }
+
+    while (c == '0')
+      c = buffer->snextc();
+
+    CDigitChunks digits;
+    digits.chunks.reserve(std::max<std::streamsize>(buffer->in_avail(), 0) / CHUNK_DIGITS);
+
+    for (; c != traits::eof() && std::isdigit(c); c = buffer->snextc())
+      digits.push(c);
+
+    if (c == traits::eof())
+      in.setstate(ios::eofbit);
+
+    CBigInt = digits.value();
+
+    return in;
+  }
+
+  friend std::ostream &operator<<(std::ostream &out, const CBigInt &CBigInt)
+  {
+    std::string number(CBigInt.printBound(), '\0');
+
+    number.resize(CBigInt.print(&number[0]));
+    out << number;
+
+    return out;
+  }
+
+  // upper bound of the characters print writes
+  size_t printBound() const
+  {
+    return bitLength(this->limbs) * 30103 / 100000 + 2;
+  }
+
+  // writes the decimal form without a terminator into buffer, which must hold printBound() chars, returns its length
+  size_t print(char *buffer) const
+  {
+    char *out = buffer;
+
+    if (this->neg)
+      *out++ = '-';
+
+    return writeDecimal(out, this->limbs.data(), this->limbs.size(), 0) - buffer;
+  }
+
+  friend void swap(CBigInt &first, CBigInt &second)
+  {
+    std::swap(first.neg, second.neg);
+    first.limbs.swap(second.limbs);
+  }
+
+  friend CBigInt abs(CBigInt CBigInt)
+  {
+    CBigInt.neg = false;
+
+    return CBigInt;
+  }
+
+  friend CBigInt operator+(CBigInt first, const CBigInt &second)
+  {
+    first += second;
+    return first;
+  }
+
+  friend CBigInt operator+(const CBigInt &first, CBigInt &&second)
+  {
+    second += first;
+    return std::move(second);
+  }
+
+  friend CBigInt operator+(CBigInt CBigInt)
+  {
+    return CBigInt;
+  }
+
+  friend CBigInt operator-(CBigInt first, const CBigInt &second)
+  {
+    first -= second;
+    return first;
+  }
+
+  friend CBigInt operator-(const CBigInt &first, CBigInt &&second)
+  {
+    second -= first;
+    return -std::move(second);
+  }
+
+  friend CBigInt operator-(CBigInt second)
+  {
+    if (!second.limbs.empty())
+      second.neg = !second.neg;
+
+    return second;
+  }
+
+  friend CBigInt operator*(const CBigInt &first, const CBigInt &second)
+  {
+    return multiply(first, second, 1);
+  }
+
+  friend CBigInt operator*(CBigInt &&first, const CBigInt &second)
+  {
+    first *= second;
+    return std::move(first);
+  }
+
+  friend CBigInt operator*(const CBigInt &first, CBigInt &&second)
+  {
+    second *= first;
+    return std::move(second);
+  }
+
+  friend CBigInt operator*(CBigInt &&first, CBigInt &&second)
+  {
+    first *= second;
+    return std::move(first);
+  }
+
+  // truncating division: the quotient rounds toward zero, the remainder takes the sign of first
+  friend std::pair<CBigInt, CBigInt> divmod(const CBigInt &first, const CBigInt &second)
+  {
+    if (second.limbs.empty())
+      throw invalid_argument("Division by zero.");
+
+    CBigInt quotient, remainder;
+
+    if (cmpLimbs(first.limbs.data(), first.limbs.size(), second.limbs.data(), second.limbs.size()) < 0)
+    {
+      remainder = first;
+      return {std::move(quotient), std::move(remainder)};
+    }
+
+    divModLimbs(quotient.limbs, remainder.limbs, first.limbs.data(), first.limbs.size(),
+                second.limbs.data(), second.limbs.size());
+    quotient.neg = !quotient.limbs.empty() && first.neg != second.neg;
+    remainder.neg = !remainder.limbs.empty() && first.neg;
+
+    return {std::move(quotient), std::move(remainder)};
+  }
+
+  friend CBigInt operator/(const CBigInt &first, const CBigInt &second)
+  {
+    return divmod(first, second).first;
+  }
+
+  friend CBigInt operator%(const CBigInt &first, const CBigInt &second)
+  {
+    return divmod(first, second).second;
+  }
+
+  friend CBigInt pow(const CBigInt &base, const CBigInt &exponent)
+  {
+    if (exponent.neg)
+      throw invalid_argument("Negative exponent.");
+
+    return slidingWindowPow(base, CBigInt(1), exponent,
+                            [](CBigInt &result, const CBigInt &x, const CBigInt &y)
+                            { result = x * y; });
+  }
+
+  // base^exponent mod |modulus|, the result is always in [0, |modulus|)
+  friend CBigInt powmod(const CBigInt &base, const CBigInt &exponent, const CBigInt &modulus)
+  {
+    if (exponent.neg)
+      throw invalid_argument("Negative exponent.");
+    if (modulus.limbs.empty())
+      throw invalid_argument("Division by zero.");
+
+    if (modulus.limbs[0] & 1)
+      return CMontgomery(modulus).powmod(base, exponent);
+
+    CBigInt mod = abs(modulus);
+
+    return slidingWindowPow(residue(base, mod), residue(CBigInt(1), mod), exponent,
+                            [&mod](CBigInt &result, const CBigInt &x, const CBigInt &y)
+                            {
+                              result = x * y;
+                              result = divmod(result, mod).second;
+                            });
+  }
+
+  // product of [first, last) as a balanced tree, subtrees and the large multiplications near the root run in parallel
+  template <typename Iterator>
+  static CBigInt product(Iterator first, Iterator last, unsigned threads = defaultThreads())
+  {
+    std::vector<CBigInt> values(first, last);
+    return productTree(values.data(), values.size(), std::max(1u, threads));
+  }
+
+  template <typename Range>
+  static CBigInt product(const Range &range, unsigned threads = defaultThreads())
+  {
+    return product(std::begin(range), std::end(range), threads);
+  }
+
+  // sum of [first, last), split into one contiguous slice per thread
+  template <typename Iterator>
+  static CBigInt sum(Iterator first, Iterator last, unsigned threads = defaultThreads())
+  {
+    std::vector<CBigInt> values(first, last);
+    return sumTree(values.data(), values.size(), std::max(1u, threads));
+  }
+
+  template <typename Range>
+  static CBigInt sum(const Range &range, unsigned threads = defaultThreads())
+  {
+    return sum(std::begin(range), std::end(range), threads);
+  }
+
+  // number of decimal digits
+  int size()
+  {
+    std::string number(printBound(), '\0');
+    size_t len = print(&number[0]);
+    return this->neg ? len - 1 : len;
+  }
+
+  CBigInt &operator+=(const CBigInt &other)
+  {
+    addSigned(other, other.neg);
+    return *this;
+  }
+
+  CBigInt &operator-=(const CBigInt &other)
+  {
+    addSigned(other, !other.neg);
+    return *this;
+  }
+
+  CBigInt &operator*=(const CBigInt &other)
+  {
+    if (this->limbs.empty() || other.limbs.empty())
+    {
+      this->limbs.clear();
+      this->neg = false;
+      return *this;
+    }
+
+    this->neg = this->neg != other.neg;
+
+    // single limb operands: hardware multiply, the high half is only stored on overflow
+    if (this->limbs.size() == 1 && other.limbs.size() == 1)
+    {
+      limb_t x = this->limbs[0], y = other.limbs[0];
+
+      if (__builtin_mul_overflow(x, y, &this->limbs[0]))
+        this->limbs.push_back((limb_t)(((dlimb_t)x * y) >> 64));
+      return *this;
+    }
+
+    if (other.limbs.size() == 1)
+    {
+      mulAddSmall(this->limbs, other.limbs[0], 0);
+      return *this;
+    }
+
+    // the product goes to a pooled buffer, the old limbs are returned to the pool
+    CScratch product(this->limbs.size() + other.limbs.size());
+
+    mulLimbs(product.data(), this->limbs.data(), this->limbs.size(), other.limbs.data(), other.limbs.size());
+    product.buffer.swap(this->limbs);
+    trim(this->limbs);
+
+    return *this;
+  }
+
+  CBigInt &operator/=(const CBigInt &other)
+  {
+    *this = divmod(*this, other).first;
+    return *this;
+  }
+
+  CBigInt &operator%=(const CBigInt &other)
+  {
+    *this = divmod(*this, other).second;
+    return *this;
+  }
+
+  // Montgomery arithmetic for a fixed odd modulus, construct once and reuse for repeated powmod calls
+  class CMontgomery
+  {
+  public:
+    CMontgomery(const CBigInt &modulus)
+        : modulus(modulus.limbs)
+    {
+      if (this->modulus.empty() || (this->modulus[0] & 1) == 0)
+        throw invalid_argument("Montgomery modulus must be odd.");
+
+      // Newton iteration doubles the correct low bits of the inverse each step
+      limb_t inv = this->modulus[0];
+      for (int i = 0; i < 5; i++)
+        inv *= 2 - this->modulus[0] * inv;
+      this->inverse = -inv;
+
+      size_t k = this->modulus.size();
+      std::vector<limb_t> power(2 * k + 1, 0);
+      CLimbs quotient;
+      power[2 * k] = 1;
+
+      divModLimbs(quotient, this->rSquared, power.data(), power.size(), this->modulus.data(), k);
+      this->rSquared.resize(k, 0);
+    }
+
+    CBigInt powmod(const CBigInt &base, const CBigInt &exponent) const
+    {
+      size_t k = this->modulus.size();
+      std::vector<limb_t> scratch(k + 2), unit(k, 0), one(k), x(k);
+      unit[0] = 1;
+
+      CBigInt reduced = residue(base, fromLimbs(this->modulus.data(), k));
+      reduced.limbs.resize(k, 0);
+
+      mul(one.data(), unit.data(), this->rSquared.data(), scratch.data());
+      mul(x.data(), reduced.limbs.data(), this->rSquared.data(), scratch.data());
+
+      std::vector<limb_t> y = slidingWindowPow(x, one, exponent,
+                                               [this, &scratch](std::vector<limb_t> &result, const std::vector<limb_t> &a, const std::vector<limb_t> &b)
+                                               { mul(result.data(), a.data(), b.data(), scratch.data()); });
+
+      mul(y.data(), y.data(), unit.data(), scratch.data());
+
+      return fromLimbs(y.data(), k);
+    }
+
+  private:
+    CLimbs modulus;
+    limb_t inverse;
+    CLimbs rSquared;
+
+    // r = a * b / 2^(64k) mod modulus (CIOS), operands have k limbs, t is scratch of k + 2 limbs; r may alias a or b
+    void mul(limb_t *r, const limb_t *a, const limb_t *b, limb_t *t) const
+    {
+      size_t k = this->modulus.size();
+      const limb_t *n = this->modulus.data();
+
+      std::fill(t, t + k + 2, 0);
+
+      for (size_t i = 0; i < k; i++)
+      {
+        limb_t carry = 0;
+
+        for (size_t j = 0; j < k; j++)
+        {
+          dlimb_t p = (dlimb_t)a[j] * b[i] + t[j] + carry;
+          t[j] = (limb_t)p;
+          carry = (limb_t)(p >> 64);
+        }
+
+        dlimb_t s = (dlimb_t)t[k] + carry;
+        t[k] = (limb_t)s;
+        t[k + 1] = (limb_t)(s >> 64);
+
+        limb_t m = t[0] * this->inverse;
+        dlimb_t p = (dlimb_t)m * n[0] + t[0];
+        carry = (limb_t)(p >> 64);
+
+        for (size_t j = 1; j < k; j++)
+        {
+          p = (dlimb_t)m * n[j] + t[j] + carry;
+          t[j - 1] = (limb_t)p;
+          carry = (limb_t)(p >> 64);
+        }
+
+        s = (dlimb_t)t[k] + carry;
+        t[k - 1] = (limb_t)s;
+        t[k] = t[k + 1] + (limb_t)(s >> 64);
+      }
+
+      if (t[k] != 0 || cmpLimbs(t, k, n, k) >= 0)
+        subLimbs(r, t, k, n, k);
+      else
+        std::copy(t, t + k, r);
+    }
+  };
+
+private:
+  static constexpr size_t SCRATCH_POOL_SIZE = 16;
+
+  // limb buffer borrowed from a per-thread pool and given back on destruction
+  struct CScratch
+  {
+    CLimbs buffer;
+
+    CScratch(size_t size)
+    {
+      std::vector<CLimbs> &pool = scratchPool();
+
+      if (!pool.empty())
+      {
+        buffer.swap(pool.back());
+        pool.pop_back();
+      }
+
+      buffer.resize(size);
+    }
+
+    ~CScratch()
+    {
+      std::vector<CLimbs> &pool = scratchPool();
+
+      if (pool.size() < SCRATCH_POOL_SIZE && !buffer.isInline())
+      {
+        buffer.clear();
+        pool.push_back(std::move(buffer));
+      }
+    }
+
+    CScratch(const CScratch &) = delete;
+    CScratch &operator=(const CScratch &) = delete;
+
+    limb_t *data() { return buffer.data(); }
+    limb_t &operator[](size_t i) { return buffer[i]; }
+  };
+
+  static std::vector<CLimbs> &scratchPool()
+  {
+    thread_local std::vector<CLimbs> pool;
+    return pool;
+  }
+
+  // *this += (otherNeg ? -1 : 1) * |other|, in place; other may be *this
+  void addSigned(const CBigInt &other, bool otherNeg)
+  {
+    size_t n = this->limbs.size();
+    size_t m = other.limbs.size();
+
+    if (m == 0)
+      return;
+
+    // both magnitudes fit in a limb: hardware add/sub, a carry promotes to two limbs
+    if (n == 1 && m == 1)
+    {
+      limb_t x = this->limbs[0], y = other.limbs[0];
+
+      if (this->neg == otherNeg)
+      {
+        if (__builtin_add_overflow(x, y, &this->limbs[0]))
+          this->limbs.push_back(1);
+      }
+      else if (x > y)
+        this->limbs[0] = x - y;
+      else if (x < y)
+      {
+        this->limbs[0] = y - x;
+        this->neg = otherNeg;
+      }
+      else
+      {
+        this->limbs.clear();
+        this->neg = false;
+      }
+      return;
+    }
+
+    if (n == 0 || this->neg == otherNeg)
+    {
+      this->neg = otherNeg;
+
+      if (n < m)
+        this->limbs.resize(m, 0);
+
+      limb_t carry = addLimbs(this->limbs.data(), this->limbs.data(), this->limbs.size(), other.limbs.data(), m);
+
+      if (carry != 0)
+        this->limbs.push_back(carry);
+      return;
+    }
+
+    int cmp = cmpLimbs(this->limbs.data(), n, other.limbs.data(), m);
+
+    if (cmp == 0)
+    {
+      this->limbs.clear();
+      this->neg = false;
+      return;
+    }
+
+    if (cmp > 0)
+      subLimbs(this->limbs.data(), this->limbs.data(), n, other.limbs.data(), m);
+    else
+    {
+      this->limbs.resize(m, 0);
+      subLimbs(this->limbs.data(), other.limbs.data(), m, this->limbs.data(), n);
+      this->neg = otherNeg;
+    }
+
+    trim(this->limbs);
+  }
+
+  static unsigned defaultThreads()
+  {
+    return std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  static CBigInt multiply(const CBigInt &first, const CBigInt &second, unsigned threads)
+  {
+    CBigInt result;
+
+    if (first.limbs.empty() || second.limbs.empty())
+      return result;
+
+    CScratch product(first.limbs.size() + second.limbs.size());
+
+    mulLimbs(product.data(), first.limbs.data(), first.limbs.size(), second.limbs.data(), second.limbs.size(), threads);
+    product.buffer.swap(result.limbs);
+    trim(result.limbs);
+    result.neg = first.neg != second.neg;
+
+    return result;
+  }
+
+  static CBigInt productTree(CBigInt *values, size_t count, unsigned threads)
   {
-    this->neg = other.neg;
-    this->number = other.number;
+    if (count == 0)
+      return 1;
+    if (count == 1)
+      return std::move(values[0]);
+
+    size_t half = count / 2;
+
+    if (threads == 1)
+      return productTree(values, half, 1) * productTree(values + half, count - half, 1);
+
+    std::future<CBigInt> left = std::async(std::launch::async, productTree, values, half, threads / 2);
+    CBigInt right = productTree(values + half, count - half, threads - threads / 2);
+
+    return multiply(left.get(), right, threads);
   }
 
-  CBigInt &operator=(const CBigInt &other)
+  static CBigInt sumTree(CBigInt *values, size_t count, unsigned threads)
   {
-    if (this != &other)
+    if (threads == 1 || count < 2)
     {
-      this->neg = other.neg;
-      this->number = other.number;
+      CBigInt result;
+
+      for (size_t i = 0; i < count; i++)
+        result += values[i];
+
+      return result;
     }
-    return *this;
+
+    size_t half = count / 2;
+    std::future<CBigInt> left = std::async(std::launch::async, sumTree, values, half, threads / 2);
+    CBigInt right = sumTree(values + half, count - half, threads - threads / 2);
+
+    return left.get() + right;
   }
 
-  CBigInt(int number)
+  static void trim(CLimbs &limbs)
   {
-    if (number < 0)
-    {
-      this->neg = true;
-      number *= -1;
-    }
+    while (!limbs.empty() && limbs.back() == 0)
+      limbs.pop_back();
+  }
+
+  static size_t trimmedSize(const limb_t *a, size_t n)
+  {
+    while (n > 0 && a[n - 1] == 0)
+      n--;
+    return n;
+  }
+
+  static CBigInt fromLimbs(const limb_t *a, size_t n)
+  {
+    CBigInt result;
+    result.limbs.assign(a, a + trimmedSize(a, n));
+    return result;
+  }
+
+  static int compare(const CBigInt &first, const CBigInt &second)
+  {
+    if (first.neg != second.neg)
+      return first.neg ? -1 : 1;
+
+    int cmp = cmpLimbs(first.limbs.data(), first.limbs.size(), second.limbs.data(), second.limbs.size());
+
+    return first.neg ? -cmp : cmp;
+  }
+
+  // compares two trimmed magnitudes
+  static int cmpLimbs(const limb_t *a, size_t n, const limb_t *b, size_t m)
+  {
+    if (n != m)
+      return n < m ? -1 : 1;
+
+    while (n-- > 0)
+      if (a[n] != b[n])
+        return a[n] < b[n] ? -1 : 1;
+
+    return 0;
+  }
 
-    if (number == 0)
+  // r[0..n) = a[0..n) + b[0..m), n >= m, returns the carry out; r may alias a
+  static limb_t addLimbs(limb_t *r, const limb_t *a, size_t n, const limb_t *b, size_t m)
+  {
+    limb_t carry = 0;
+    size_t i = 0;
+
+    for (; i < m; i++)
     {
-      this->number = "0";
-      return;
+      dlimb_t sum = (dlimb_t)a[i] + b[i] + carry;
+      r[i] = (limb_t)sum;
+      carry = (limb_t)(sum >> 64);
     }
 
-    this->number = "";
-
-    while (number > 0)
+    for (; i < n; i++)
     {
-      this->number += (number % 10) + '0';
-      number /= 10;
+      limb_t sum = a[i] + carry;
+      carry = sum < carry;
+      r[i] = sum;
     }
-  }
 
-  CBigInt(const char *number)
-  {
-    std::string number_(number);
-    *(this) = number_;
+    return carry;
   }
 
-  CBigInt(std::string number)
+  // r[0..n) = a[0..n) - b[0..m), n >= m, returns the borrow out; r may alias a
+  static limb_t subLimbs(limb_t *r, const limb_t *a, size_t n, const limb_t *b, size_t m)
   {
-    if (!isValidNumber(number))
+    limb_t borrow = 0;
+    size_t i = 0;
+
+    for (; i < m; i++)
     {
-      throw invalid_argument("Invalid number.");
+      limb_t x = a[i], y = b[i];
+      limb_t diff = x - y;
+      limb_t next = (x < y) | (diff < borrow);
+      r[i] = diff - borrow;
+      borrow = next;
     }
 
-    while (number[0] == '-')
+    for (; i < n; i++)
     {
-      this->neg = !this->neg;
-      number.erase(0, 1);
+      limb_t x = a[i];
+      r[i] = x - borrow;
+      borrow = x < borrow;
     }
 
-    reverse(number.begin(), number.end());
+    return borrow;
+  }
 
-    while (number.size() > 1 && number[number.size() - 1] == '0')
-      number.erase(number.size() - 1, number.size());
+  // value reduced into [0, |modulus|)
+  static CBigInt residue(const CBigInt &value, const CBigInt &modulus)
+  {
+    CBigInt result = divmod(value, modulus).second;
 
-    if (number == "")
-      number = "0";
+    if (result.neg)
+    {
+      size_t len = result.limbs.size();
 
-    this->number = number;
+      result.neg = false;
+      result.limbs.resize(modulus.limbs.size(), 0);
+      subLimbs(result.limbs.data(), modulus.limbs.data(), modulus.limbs.size(), result.limbs.data(), len);
+      trim(result.limbs);
+    }
 
-    if (number == "0")
-      this->neg = false;
+    return result;
   }
 
-  friend bool operator==(CBigInt first, CBigInt second)
+  static size_t bitLength(const CLimbs &limbs)
   {
-    return first.number == second.number && second.neg == first.neg;
+    if (limbs.empty())
+      return 0;
+
+    return limbs.size() * 64 - __builtin_clzll(limbs.back());
   }
 
-  friend bool operator!=(CBigInt first, CBigInt second)
+  static bool testBit(const CLimbs &limbs, size_t bit)
   {
-    return !(first == second);
+    return (limbs[bit / 64] >> (bit % 64)) & 1;
   }
 
-  friend bool operator<(CBigInt first, CBigInt second)
+  // left-to-right sliding window exponentiation, mul(result, x, y) stores the (reduced) product x * y
+  template <typename T, typename Mul>
+  static T slidingWindowPow(const T &base, const T &one, const CBigInt &exponent, Mul mul)
   {
-    if (first.neg && !second.neg)
-      return true;
-    if (!first.neg && second.neg)
-      return false;
+    size_t bits = bitLength(exponent.limbs);
+    T result = one;
 
-    if (first.neg && second.neg)
+    if (bits == 0)
+      return result;
+
+    size_t window = bits > 512 ? 5 : bits > 128 ? 4 : bits > 32 ? 3 : bits > 8 ? 2 : 1;
+
+    // odd[i] = base^(2i + 1)
+    std::vector<T> odd(size_t(1) << (window - 1), base);
+
+    if (window > 1)
     {
-      first.neg = false;
-      second.neg = false;
+      T square = base;
+      mul(square, base, base);
 
-      return first > second;
+      for (size_t i = 1; i < odd.size(); i++)
+        mul(odd[i], odd[i - 1], square);
     }
 
-    if ((first.number).size() < (second.number).size())
-      return true;
-    if ((first.number).size() > (second.number).size())
-      return false;
+    bool started = false;
+
+    for (size_t i = bits; i > 0;)
+    {
+      if (!testBit(exponent.limbs, i - 1))
+      {
+        if (started)
+          mul(result, result, result);
+        i--;
+        continue;
+      }
 
-    std::string temp1 = first.number;
-    reverse(temp1.begin(), temp1.end());
-    std::string temp2 = second.number;
-    reverse(temp2.begin(), temp2.end());
+      // the window covers bits [low, i) and ends with a set bit
+      size_t low = i > window ? i - window : 0;
+      while (!testBit(exponent.limbs, low))
+        low++;
 
-    for (unsigned int i = 0; i < temp1.size(); i++)
-      if (temp1[i] < temp2[i])
-        return true;
-      else if (temp1[i] > temp2[i])
-        return false;
+      size_t value = 0;
 
-    return false;
+      for (size_t bit = i; bit-- > low;)
+      {
+        value = value << 1 | testBit(exponent.limbs, bit);
+        if (started)
+          mul(result, result, result);
+      }
+
+      if (started)
+        mul(result, result, odd[value >> 1]);
+      else
+        result = odd[value >> 1];
+
+      started = true;
+      i = low;
+    }
+
+    return result;
+  }
+
+  // v = v * mul + add
+  static void mulAddSmall(CLimbs &v, limb_t mul, limb_t add)
+  {
+    limb_t carry = add;
+
+    for (limb_t &limb : v)
+    {
+      dlimb_t t = (dlimb_t)limb * mul + carry;
+      limb = (limb_t)t;
+      carry = (limb_t)(t >> 64);
+    }
+
+    if (carry != 0)
+      v.push_back(carry);
   }
 
-  friend bool operator<=(CBigInt first, CBigInt second)
+  // q[0..n) = a[0..n) / d, returns the remainder; q may alias a
+  static limb_t divSmall(limb_t *q, const limb_t *a, size_t n, limb_t d)
   {
-    return (first == second) || (first < second);
+    limb_t rem = 0;
+
+    while (n-- > 0)
+    {
+      dlimb_t cur = ((dlimb_t)rem << 64) | a[n];
+      q[n] = (limb_t)(cur / d);
+      rem = (limb_t)(cur % d);
+    }
+
+    return rem;
   }
 
-  friend bool operator>(CBigInt first, CBigInt second)
+  // r[0..n+m) = a[0..n) * b[0..m), r must not overlap the inputs
+  static void mulSchool(limb_t *r, const limb_t *a, size_t n, const limb_t *b, size_t m)
   {
-    if (!first.neg && second.neg)
-      return true;
-    if (first.neg && !second.neg)
-      return false;
+    std::fill(r, r + n + m, 0);
 
-    if (first.neg && second.neg)
+    for (size_t i = 0; i < n; i++)
     {
-      first.neg = false;
-      second.neg = false;
+      limb_t carry = 0;
+      limb_t ai = a[i];
+
+      if (ai == 0)
+        continue;
+
+      for (size_t j = 0; j < m; j++)
+      {
+        dlimb_t t = (dlimb_t)ai * b[j] + r[i + j] + carry;
+        r[i + j] = (limb_t)t;
+        carry = (limb_t)(t >> 64);
+      }
+
+      r[i + m] = carry;
+    }
+  }
 
-      return first < second;
+  // r[0..n+m) = a[0..n) * b[0..m), r must not overlap the inputs; large splits spread over up to threads threads
+  static void mulLimbs(limb_t *r, const limb_t *a, size_t n, const limb_t *b, size_t m, unsigned threads = 1)
+  {
+    if (n < m)
+    {
+      std::swap(a, b);
+      std::swap(n, m);
     }
 
-    if ((first.number).size() > (second.number).size())
-      return true;
-    if ((first.number).size() < (second.number).size())
-      return false;
+    if (m < KARATSUBA_THRESHOLD)
+    {
+      mulSchool(r, a, n, b, m);
+      return;
+    }
 
-    std::string temp1 = first.number;
-    reverse(temp1.begin(), temp1.end());
-    std::string temp2 = second.number;
-    reverse(temp2.begin(), temp2.end());
+    // unbalanced operands: multiply the longer one block by block
+    if (2 * m <= n)
+    {
+      std::fill(r, r + n + m, 0);
+      CScratch block(2 * m);
 
-    for (unsigned int i = 0; i < temp1.size(); i++)
-      if (temp1[i] > temp2[i])
-        return true;
-      else if (temp1[i] < temp2[i])
-        return false;
+      for (size_t i = 0; i < n; i += m)
+      {
+        size_t len = std::min(m, n - i);
+        mulLimbs(block.data(), a + i, len, b, m, threads);
+        addLimbs(r + i, r + i, n + m - i, block.data(), len + m);
+      }
+      return;
+    }
 
-    return false;
+    if (m < TOOM3_THRESHOLD)
+      mulKaratsuba(r, a, n, b, m);
+    else
+      mulToom3(r, a, n, b, m, threads);
   }
 
-  friend bool operator>=(CBigInt first, CBigInt second)
+  // n >= m > n / 2
+  static void mulKaratsuba(limb_t *r, const limb_t *a, size_t n, const limb_t *b, size_t m)
   {
-    return (first == second) || (first > second);
+    size_t h = (n + 1) / 2;
+    size_t an = n - h;
+    size_t bn = m - h;
+
+    CScratch sa(h + 1), sb(h + 1), mid(2 * h + 2);
+
+    sa[h] = addLimbs(sa.data(), a, h, a + h, an);
+    sb[h] = addLimbs(sb.data(), b, h, b + h, bn);
+
+    // r holds a0 * b0 in the low half and a1 * b1 in the high half
+    mulLimbs(r, a, h, b, h);
+    mulLimbs(r + 2 * h, a + h, an, b + h, bn);
+    mulLimbs(mid.data(), sa.data(), h + 1, sb.data(), h + 1);
+
+    subLimbs(mid.data(), mid.data(), 2 * h + 2, r, 2 * h);
+    subLimbs(mid.data(), mid.data(), 2 * h + 2, r + 2 * h, an + bn);
+
+    addLimbs(r + h, r + h, n + m - h, mid.data(), trimmedSize(mid.data(), 2 * h + 2));
   }
 
-  bool isValidNumber(const string &val)
+  // n >= m > n / 2, interpolation sequence by Bodrato
+  static void mulToom3(limb_t *r, const limb_t *a, size_t n, const limb_t *b, size_t m, unsigned threads)
   {
-    // Check if the string represents a valid decimal number
-    if (val.empty())
-      return false;
+    size_t k = (n + 2) / 3;
 
-    size_t pos = 0;
+    CBigInt a0 = fromLimbs(a, k), a1 = fromLimbs(a + k, k), a2 = fromLimbs(a + 2 * k, n - 2 * k);
+    CBigInt b0 = fromLimbs(b, k), b1 = fromLimbs(b + k, std::min(k, m - k));
+    CBigInt b2 = m > 2 * k ? fromLimbs(b + 2 * k, m - 2 * k) : CBigInt();
 
-    // Skip sign if present
-    if (val[pos] == '-' || val[pos] == '+')
-      pos++;
+    CBigInt pa = a0 + a2, pb = b0 + b2;
+    CBigInt pa1 = pa + a1, pb1 = pb + b1;
+    CBigInt pam1 = pa - a1, pbm1 = pb - b1;
+    CBigInt pam2 = pam1 + a2, pbm2 = pbm1 + b2;
+    pam2 = pam2 + pam2 - a0;
+    pbm2 = pbm2 + pbm2 - b0;
 
-    // Empty string after sign is invalid
-    if (pos >= val.size())
-      return false;
+    CBigInt r0, r1, rm1, rm2, r4;
 
-    // Check each character
-    for (; pos < val.size(); pos++)
+    if (threads > 1 && k >= PARALLEL_THRESHOLD)
     {
-      if (!std::isdigit(val[pos]))
-        return false;
+      // the five point products are dealt round-robin to at most threads tasks, this thread runs task 0
+      unsigned tasks = std::min(threads, 5u);
+      const CBigInt *xs[] = {&a0, &pa1, &pam1, &pam2, &a2}, *ys[] = {&b0, &pb1, &pbm1, &pbm2, &b2};
+      CBigInt *rs[] = {&r0, &r1, &rm1, &rm2, &r4};
+      auto run = [&](unsigned task, unsigned share)
+      {
+        for (unsigned i = task; i < 5; i += tasks)
+          *rs[i] = multiply(*xs[i], *ys[i], share);
+      };
+
+      std::vector<std::future<void>> workers;
+      for (unsigned task = 1; task < tasks; task++)
+        workers.push_back(std::async(std::launch::async, run, task, threads / tasks));
+      run(0, threads - (tasks - 1) * (threads / tasks));
+      for (std::future<void> &worker : workers)
+        worker.get();
+    }
+    else
+    {
+      r0 = a0 * b0;
+      r1 = pa1 * pb1;
+      rm1 = pam1 * pbm1;
+      rm2 = pam2 * pbm2;
+      r4 = a2 * b2;
     }
 
-    return true;
+    CBigInt r3 = rm2 - r1;
+    divSmall(r3.limbs.data(), r3.limbs.data(), r3.limbs.size(), 3);
+    trim(r3.limbs);
+    r1 = r1 - rm1;
+    divSmall(r1.limbs.data(), r1.limbs.data(), r1.limbs.size(), 2);
+    trim(r1.limbs);
+    CBigInt r2 = rm1 - r0;
+    r3 = r2 - r3;
+    divSmall(r3.limbs.data(), r3.limbs.data(), r3.limbs.size(), 2);
+    trim(r3.limbs);
+    r3 = r3 + r4 + r4;
+    r2 = r2 + r1 - r4;
+    r1 = r1 - r3;
+
+    std::fill(r, r + n + m, 0);
+
+    const CBigInt *coefficients[] = {&r0, &r1, &r2, &r3, &r4};
+
+    for (size_t i = 0; i < 5; i++)
+    {
+      const CLimbs &c = coefficients[i]->limbs;
+      if (!c.empty())
+        addLimbs(r + i * k, r + i * k, n + m - i * k, c.data(), c.size());
+    }
   }
 
-  friend std::istream &operator>>(std::istream &in, CBigInt &CBigInt)
+  // Knuth's algorithm D, q = a / b and rem = a % b for trimmed magnitudes with n >= m > 0
+  static void divModLimbs(CLimbs &q, CLimbs &rem,
+                          const limb_t *a, size_t n, const limb_t *b, size_t m)
   {
-    std::string number;
-    in >> number;
+    q.assign(n - m + 1, 0);
 
-    CBigInt.neg = false;
+    if (m == 1)
+    {
+      limb_t r = divSmall(q.data(), a, n, b[0]);
+      rem.assign(r != 0 ? 1 : 0, r);
+      trim(q);
+      return;
+    }
+
+    int shift = __builtin_clzll(b[m - 1]);
+    CScratch vn(m), un(n + 1);
+
+    for (size_t i = m - 1; i > 0; i--)
+      vn[i] = shift ? (b[i] << shift) | (b[i - 1] >> (64 - shift)) : b[i];
+    vn[0] = b[0] << shift;
 
-    // while (number[0] == '-')
-    // {
-    //   CBigInt.neg = !CBigInt.neg;
-    //   number.erase(0, 1);
-    // }
+    un[n] = shift ? a[n - 1] >> (64 - shift) : 0;
+    for (size_t i = n - 1; i > 0; i--)
+      un[i] = shift ? (a[i] << shift) | (a[i - 1] >> (64 - shift)) : a[i];
+    un[0] = a[0] << shift;
 
-    bool first = true;
-    for (auto it = number.begin(); it != number.end();)
+    for (size_t j = n - m + 1; j-- > 0;)
     {
-      if (!std::isdigit(*it) && first)
+      dlimb_t num = ((dlimb_t)un[j + m] << 64) | un[j + m - 1];
+      dlimb_t qhat = num / vn[m - 1];
+      dlimb_t rhat = num % vn[m - 1];
+
+      while ((qhat >> 64) != 0 || qhat * vn[m - 2] > ((rhat << 64) | un[j + m - 2]))
       {
-        in.setstate(ios::failbit);
-        return in;
+        qhat--;
+        rhat += vn[m - 1];
+        if ((rhat >> 64) != 0)
+          break;
       }
-      else if (!std::isdigit(*it))
+
+      limb_t carry = 0, borrow = 0;
+
+      for (size_t i = 0; i < m; i++)
       {
-        it = number.erase(it);
+        dlimb_t p = qhat * vn[i] + carry;
+        carry = (limb_t)(p >> 64);
+        limb_t low = (limb_t)p, x = un[i + j];
+        limb_t diff = x - low;
+        limb_t next = (x < low) | (diff < borrow);
+        un[i + j] = diff - borrow;
+        borrow = next;
       }
-      else
+
+      limb_t x = un[j + m];
+      limb_t diff = x - carry;
+      limb_t next = (x < carry) | (diff < borrow);
+      un[j + m] = diff - borrow;
+
+      if (next)
       {
-        ++it;
+        qhat--;
+        un[j + m] += addLimbs(un.data() + j, un.data() + j, m, vn.data(), m);
       }
 
-      first = false;
+      q[j] = (limb_t)qhat;
     }
 
-    reverse(number.begin(), number.end());
+    rem.resize(m);
+    for (size_t i = 0; i < m; i++)
+      rem[i] = shift ? (un[i] >> shift) | (un[i + 1] << (64 - shift)) : un[i];
+
+    trim(q);
+    trim(rem);
+  }
 
-    while (number.size() > 1 && number[number.size() - 1] == '0')
+  static CBigInt shiftLimbs(CBigInt x, ptrdiff_t shift)
+  {
+    if (shift > 0 && !x.limbs.empty())
+      x.limbs.insert(x.limbs.begin(), shift, 0);
+    else if (shift < 0)
     {
-      number.erase(number.size() - 1, number.size());
+      x.limbs.erase(x.limbs.begin(), x.limbs.begin() + std::min<size_t>(-shift, x.limbs.size()));
+      if (x.limbs.empty())
+        x.neg = false;
     }
 
-    CBigInt.number = number;
-
-    if (number == "0")
-      CBigInt.neg = false;
-
-    return in;
+    return x;
   }
 
-  friend std::ostream &operator<<(std::ostream &out, const CBigInt &CBigInt)
+  // floor(B^(2k) / d) for a k limb divisor, refined by a Newton step from the reciprocal of its top half
+  static CBigInt reciprocal(const CBigInt &d)
   {
-    std::string number = CBigInt.number;
-    reverse(number.begin(), number.end());
+    size_t k = d.limbs.size();
+    CBigInt power = shiftLimbs(CBigInt(1), 2 * k);
 
-    if (CBigInt.neg && CBigInt.number != "0")
-      number = '-' + number;
+    if (k <= RECIPROCAL_THRESHOLD)
+      return divmod(power, d).first;
 
-    out << number;
+    size_t h = (k + 1) / 2;
+    CBigInt x = shiftLimbs(reciprocal(fromLimbs(d.limbs.data() + k - h, h)), k - h);
 
-    return out;
+    // x += x * (B^(2k) - d * x) / B^(2k) doubles the number of correct limbs
+    x += shiftLimbs(x * (power - d * x), -(ptrdiff_t)(2 * k));
+
+    // the estimate is now off by a few units, the exact correction is a short division
+    std::pair<CBigInt, CBigInt> correction = divmod(power - d * x, d);
+
+    if (correction.second.neg)
+      correction.first -= 1;
+
+    return x + correction.first;
   }
 
-  friend void swap(CBigInt &first, CBigInt &second)
+  // 10^(CHUNK_DIGITS * 2^level), cached for the divide-and-conquer base conversion
+  static const CBigInt &powerOfTen(size_t level)
   {
-    CBigInt temp(first);
+    static std::deque<CBigInt> powers;
+    static std::mutex lock;
+    std::lock_guard<std::mutex> guard(lock);
+
+    if (powers.empty())
+      powers.push_back(CBigInt::fromLimbs(&CHUNK_BASE, 1));
 
-    first = second;
-    second = temp;
+    while (powers.size() <= level)
+      powers.push_back(powers.back() * powers.back());
+
+    return powers[level];
   }
 
-  friend CBigInt abs(CBigInt CBigInt)
+  // Barrett reciprocal of powerOfTen(level)
+  static const CBigInt &powerOfTenReciprocal(size_t level)
   {
-    CBigInt.neg = false;
+    static std::deque<CBigInt> reciprocals;
+    static std::mutex lock;
+    std::lock_guard<std::mutex> guard(lock);
 
-    return CBigInt;
+    while (reciprocals.size() <= level)
+      reciprocals.push_back(reciprocal(powerOfTen(reciprocals.size())));
+
+    return reciprocals[level];
   }
 
-  friend CBigInt operator+(CBigInt first, CBigInt second)
+  // Barrett division of a[0..n) by powerOfTen(level), which must have fewer than n but at least n / 2 limbs
+  static std::pair<CBigInt, CBigInt> divModPowerOfTen(const limb_t *a, size_t n, size_t level)
   {
-    bool neg = false;
+    const CBigInt &divisor = powerOfTen(level);
+    size_t k = divisor.limbs.size();
+
+    CBigInt quotient = shiftLimbs(fromLimbs(a + k - 1, n - k + 1) * powerOfTenReciprocal(level), -(ptrdiff_t)(k + 1));
+    CBigInt remainder = fromLimbs(a, n) - quotient * divisor;
 
-    if (!first.neg && second.neg)
+    while (remainder >= divisor)
     {
-      second.neg = false;
-      return first - second;
+      remainder -= divisor;
+      quotient += 1;
     }
 
-    if (first.neg && !second.neg)
+    return {std::move(quotient), std::move(remainder)};
+  }
+
+  // collects decimal digits into base 10^19 chunks as they arrive
+  struct CDigitChunks
+  {
+    // full chunks, most significant first
+    std::vector<limb_t> chunks;
+    limb_t tail = 0;
+    limb_t tailScale = 1;
+    size_t tailDigits = 0;
+
+    void push(char digit)
     {
-      first.neg = false;
-      return second - first;
+      tail = tail * 10 + (digit - '0');
+      tailScale *= 10;
+
+      if (++tailDigits == CHUNK_DIGITS)
+      {
+        chunks.push_back(tail);
+        tail = 0;
+        tailScale = 1;
+        tailDigits = 0;
+      }
     }
 
-    if (first.neg && second.neg)
+    CBigInt value() const
     {
-      neg = true;
-      first.neg = second.neg = false;
-    }
+      CBigInt result = parseChunks(chunks.data(), chunks.size());
 
-    int n = first.number.size();
-    int m = second.number.size();
+      if (tailDigits != 0)
+      {
+        mulAddSmall(result.limbs, tailScale, tail);
+        trim(result.limbs);
+      }
 
-    int carry = 0;
+      return result;
+    }
+  };
 
-    std::string result;
+  // value of count base 10^19 chunks, most significant first
+  static CBigInt parseChunks(const limb_t *chunks, size_t count)
+  {
+    CBigInt result;
 
-    for (int i = 0; i < std::max(n, m); i++)
+    if (count <= CONVERSION_THRESHOLD)
     {
-      int add = carry;
-
-      if (i < n)
-        add += first.number[i] - '0';
-      if (i < m)
-        add += second.number[i] - '0';
-
-      carry = add / 10;
+      for (size_t i = 0; i < count; i++)
+        mulAddSmall(result.limbs, CHUNK_BASE, chunks[i]);
 
-      result += add % 10 + '0';
+      trim(result.limbs);
+      return result;
     }
 
-    if (carry != 0)
-      result += carry + '0';
+    size_t level = 0;
+    while ((size_t(2) << level) < count)
+      level++;
 
-    reverse(result.begin(), result.end());
+    size_t lowCount = size_t(1) << level;
 
-    CBigInt result_(result);
-    result_.neg = neg;
+    result = parseChunks(chunks, count - lowCount);
+    result *= powerOfTen(level);
+    result += parseChunks(chunks + count - lowCount, lowCount);
 
-    return result_;
+    return result;
   }
 
-  friend CBigInt operator+(CBigInt CBigInt)
+  // parses an optionally signed decimal number, throws invalid_argument on anything else
+  void assignDecimal(const char *number, size_t len)
   {
-    return CBigInt;
-  }
+    size_t pos = 0;
+    bool negative = false;
 
-  friend CBigInt operator-(CBigInt first, CBigInt second)
-  {
-    if (second.neg)
+    if (len > 0 && (number[0] == '-' || number[0] == '+'))
     {
-      second.neg = false;
-      return first + second;
+      negative = number[0] == '-';
+      pos++;
     }
 
-    if (first.neg)
-    {
-      second.neg = true;
-      return first + second;
-    }
+    if (pos == len)
+      throw invalid_argument("Invalid number.");
+
+    while (pos < len && number[pos] == '0')
+      pos++;
 
-    bool neg = false;
+    CDigitChunks digits;
+    digits.chunks.reserve((len - pos) / CHUNK_DIGITS);
 
-    if (first < abs(second))
+    for (; pos < len; pos++)
     {
-      neg = true;
+      if (!std::isdigit((unsigned char)number[pos]))
+        throw invalid_argument("Invalid number.");
 
-      swap(first, second);
-      first = abs(first);
+      digits.push(number[pos]);
     }
 
-    int n = first.number.size();
-    int m = second.number.size();
-
-    int carry = 0;
+    *this = digits.value();
+    this->neg = negative && !this->limbs.empty();
+  }
 
-    std::string result;
+  // writes the decimal form of a[0..n) left padded with zeros to width digits, returns the end of the output
+  static char *writeDecimal(char *out, const limb_t *a, size_t n, size_t width)
+  {
+    n = trimmedSize(a, n);
 
-    for (int i = 0; i < std::max(n, m); i++)
+    if (n <= CONVERSION_THRESHOLD)
     {
-      int add = carry;
+      CScratch rest(n), chunks(n + 1);
+      size_t count = 0;
 
-      if (i < n)
-        add += first.number[i] - '0';
-      if (i < m)
-        add -= second.number[i] - '0';
+      std::copy(a, a + n, rest.data());
 
-      if (add < 0)
+      // base 10^19 chunks, least significant first
+      while (n > 0)
       {
-        carry = -1;
-        result += add + 10 + '0';
+        chunks[count++] = divSmall(rest.data(), rest.data(), n, CHUNK_BASE);
+        n = trimmedSize(rest.data(), n);
       }
 
-      else
+      char top[CHUNK_DIGITS];
+      size_t topDigits = 0;
+
+      for (limb_t chunk = count ? chunks[count - 1] : 0; chunk != 0; chunk /= 10)
+        top[topDigits++] = (char)('0' + chunk % 10);
+
+      size_t digits = count ? topDigits + (count - 1) * CHUNK_DIGITS : 0;
+
+      if (digits == 0 && width == 0)
       {
-        carry = 0;
-        result += add + '0';
+        *out++ = '0';
+        return out;
       }
-    }
 
-    reverse(result.begin(), result.end());
+      for (; digits < width; digits++)
+        *out++ = '0';
+
+      while (topDigits > 0)
+        *out++ = top[--topDigits];
+
+      for (size_t i = count; i-- > 1;)
+      {
+        limb_t chunk = chunks[i - 1];
+
+        for (size_t j = CHUNK_DIGITS; j-- > 0; chunk /= 10)
+          out[j] = (char)('0' + chunk % 10);
 
-    CBigInt result_(result);
+        out += CHUNK_DIGITS;
+      }
+
+      return out;
+    }
+
+    size_t level = 0;
+    while (powerOfTen(level + 1).limbs.size() < n)
+      level++;
 
-    result_.neg = neg;
+    size_t lowDigits = CHUNK_DIGITS << level;
+    std::pair<CBigInt, CBigInt> parts = divModPowerOfTen(a, n, level);
 
-    return result_;
+    out = writeDecimal(out, parts.first.limbs.data(), parts.first.limbs.size(), width > lowDigits ? width - lowDigits : 0);
+    return writeDecimal(out, parts.second.limbs.data(), parts.second.limbs.size(), lowDigits);
   }
+};
 
-  friend CBigInt operator-(CBigInt second)
+#ifndef __PROGTEST__
+#ifdef CBIGINT_BENCHMARK
+// Benchmark build instead of the tests:
+//   g++ -std=c++20 -O2 -DCBIGINT_BENCHMARK test.cpp -o benchmark
+//   ./benchmark [--json] [--max-digits N] [--baseline old.csv] [--tolerance 0.10] > new.csv
+// Results are CSV (op,digits,iterations,ns_per_op) unless --json is given. A baseline must be a
+// CSV produced by an earlier run; slowdowns above the tolerance are reported on stderr and make
+// the run exit with a failure.
+#include <chrono>
+#include <random>
+#include <map>
+#include <fstream>
+
+struct SBenchResult
+{
+  std::string op;
+  size_t digits;
+  size_t iterations;
+  double nsPerOp;
+};
+
+static volatile size_t benchSink;
+
+static std::string randomDigits(std::mt19937_64 &rng, size_t digits)
+{
+  std::string result(digits, '0');
+
+  for (char &c : result)
+    c = (char)('0' + rng() % 10);
+  result[0] = (char)('1' + rng() % 9);
+
+  return result;
+}
+
+// doubles the batch until it runs for at least 50 ms, then keeps the best of three batches
+template <typename Op>
+static SBenchResult measure(const std::string &op, size_t digits, Op run)
+{
+  using clock = std::chrono::steady_clock;
+
+  auto timeBatch = [&run](size_t iterations)
   {
-    CBigInt first("0");
-    return first - second;
-  }
+    clock::time_point start = clock::now();
+    for (size_t i = 0; i < iterations; i++)
+      run();
+    return std::chrono::duration<double, std::nano>(clock::now() - start).count();
+  };
+
+  size_t iterations = 1;
+  double elapsed = timeBatch(iterations);
 
-  friend CBigInt operator*(CBigInt first, CBigInt second)
+  while (elapsed < 5e7)
   {
-    bool neg = first.neg != second.neg;
+    iterations *= 2;
+    elapsed = timeBatch(iterations);
+  }
 
-    first.neg = false;
-    second.neg = false;
+  double best = elapsed;
 
-    int n = first.number.size();
-    int m = second.number.size();
+  // a single run above a second is stable enough on its own
+  if (elapsed < 1e9)
+    for (int rep = 0; rep < 2; rep++)
+      best = std::min(best, timeBatch(iterations));
 
-    CBigInt result_;
+  return {op, digits, iterations, best / iterations};
+}
 
-    for (int i = 0; i < n; i++)
-    {
-      int carry = 0;
+static std::vector<SBenchResult> runBenchmarks(size_t maxDigits)
+{
+  std::vector<SBenchResult> results;
+  std::mt19937_64 rng(20230317);
 
-      std::string result;
+  for (size_t digits = 10; digits <= maxDigits; digits *= 10)
+  {
+    std::string first = randomDigits(rng, digits), second = randomDigits(rng, digits);
+    CBigInt x(first), y(second), z = x + 1;
+    std::vector<char> buffer(x.printBound());
+
+    results.push_back(measure("parse", digits, [&]
+                              { benchSink = benchSink + CBigInt(first).limbs.size(); }));
+    results.push_back(measure("print", digits, [&]
+                              { benchSink = benchSink + x.print(buffer.data()); }));
+    results.push_back(measure("add", digits, [&]
+                              { benchSink = benchSink + (x + y).limbs.size(); }));
+    results.push_back(measure("mul", digits, [&]
+                              { benchSink = benchSink + (x * y).limbs.size(); }));
+    results.push_back(measure("cmp", digits, [&]
+                              { benchSink = benchSink + (x < z); }));
+  }
 
-      for (int j = 0; j < i; j++)
-        result += '0';
+  return results;
+}
 
-      for (int j = 0; j < m; j++)
-      {
-        int add = carry + (first.number[i] - '0') * (second.number[j] - '0');
+static void writeResults(std::ostream &out, const std::vector<SBenchResult> &results, bool json)
+{
+  out << std::fixed << std::setprecision(1);
 
-        carry = add / 10;
+  if (!json)
+  {
+    out << "op,digits,iterations,ns_per_op\n";
+    for (const SBenchResult &r : results)
+      out << r.op << ',' << r.digits << ',' << r.iterations << ',' << r.nsPerOp << '\n';
+    return;
+  }
 
-        result += add % 10 + '0';
-      }
+  out << "[\n";
+  for (size_t i = 0; i < results.size(); i++)
+  {
+    const SBenchResult &r = results[i];
+    out << "  {\"op\": \"" << r.op << "\", \"digits\": " << r.digits << ", \"iterations\": " << r.iterations
+        << ", \"ns_per_op\": " << r.nsPerOp << '}' << (i + 1 < results.size() ? ",\n" : "\n");
+  }
+  out << "]\n";
+}
 
-      if (carry != 0)
-        result += carry + '0';
+// returns false if any operation got slower than the baseline by more than tolerance
+static bool compareBaseline(const std::string &fileName, const std::vector<SBenchResult> &results, double tolerance)
+{
+  std::ifstream in(fileName);
+
+  if (!in)
+  {
+    std::cerr << "cannot read baseline " << fileName << '\n';
+    return false;
+  }
 
-      reverse(result.begin(), result.end());
+  std::map<std::pair<std::string, size_t>, double> baseline;
+  std::string line;
 
-      CBigInt current(result);
+  std::getline(in, line);
+  while (std::getline(in, line))
+  {
+    std::istringstream fields(line);
+    std::string op, digits, iterations, ns;
 
-      result_ += current;
-    }
+    if (std::getline(fields, op, ',') && std::getline(fields, digits, ',') &&
+        std::getline(fields, iterations, ',') && std::getline(fields, ns))
+      baseline[{op, std::stoul(digits)}] = std::stod(ns);
+  }
 
-    result_.neg = neg;
+  bool ok = true;
 
-    return result_;
+  for (const SBenchResult &r : results)
+  {
+    auto it = baseline.find({r.op, r.digits});
+    if (it == baseline.end())
+      continue;
+
+    double ratio = r.nsPerOp / it->second;
+    bool regression = ratio > 1 + tolerance;
+
+    std::cerr << std::setw(6) << r.op << std::setw(9) << r.digits << "  " << std::fixed << std::setprecision(2)
+              << ratio << "x" << (regression ? "  REGRESSION" : "") << '\n';
+    ok = ok && !regression;
   }
 
-  int size()
+  return ok;
+}
+
+int main(int argc, char *argv[])
+{
+  bool json = false;
+  size_t maxDigits = 1000000;
+  double tolerance = 0.10;
+  std::string baseline;
+
+  for (int i = 1; i < argc; i++)
   {
-    return this->number.size();
+    std::string arg = argv[i];
+
+    if (arg == "--json")
+      json = true;
+    else if (arg == "--max-digits" && i + 1 < argc)
+      maxDigits = std::stoul(argv[++i]);
+    else if (arg == "--baseline" && i + 1 < argc)
+      baseline = argv[++i];
+    else if (arg == "--tolerance" && i + 1 < argc)
+      tolerance = std::stod(argv[++i]);
+    else
+    {
+      std::cerr << "usage: " << argv[0] << " [--json] [--max-digits N] [--baseline old.csv] [--tolerance 0.10]\n";
+      return EXIT_FAILURE;
+    }
   }
 
-  void operator+=(CBigInt CBigInt) { *(this) = *(this) + CBigInt; }
-  void operator-=(CBigInt CBigInt) { *(this) = *(this) - CBigInt; }
+  std::vector<SBenchResult> results = runBenchmarks(maxDigits);
 
-  void operator*=(CBigInt CBigInt) { *(this) = *(this) * CBigInt; }
-};
+  writeResults(std::cout, results, json);
 
-#ifndef __PROGTEST__
+  if (!baseline.empty() && !compareBaseline(baseline, results, tolerance))
+    return EXIT_FAILURE;
+
+  return EXIT_SUCCESS;
+}
+#else
 static bool equal(const CBigInt &x, const char val[])
 {
   std::ostringstream oss;
@@ -596,6 +1907,158 @@ int main()
   assert(!(a == -87654321));
   assert(a != -87654321);
 
+  // (10^k - 1)^2 == 9...980...01, large enough for Karatsuba and Toom-3
+  for (size_t k : {1000, 6000})
+  {
+    std::string nines(k, '9');
+    std::string square = std::string(k - 1, '9') + "8" + std::string(k - 1, '0') + "1";
+    a = nines;
+    b = a * a;
+    assert(equal(b, square.c_str()));
+    b = a * -a;
+    assert(equal(b, ("-" + square).c_str()));
+  }
+
+  std::string digits;
+  for (int i = 0; i < 20000; i++)
+    digits += (char)('0' + (i * 7 + i / 13) % 10);
+  digits[0] = '1';
+  a = digits;
+  assert(equal(a, digits.c_str()));
+  assert(a - digits == 0);
+  assert(a + 1 > digits);
+
+  a = "-18446744073709551616";
+  b = 5 - a;
+  assert(equal(b, "18446744073709551621"));
+  b = CBigInt(7) * (a - 1);
+  assert(equal(b, "-129127208515966861319"));
+  b = a;
+  b += b;
+  assert(equal(b, "-36893488147419103232"));
+  b -= b;
+  assert(equal(b, "0"));
+  b = a;
+  b *= b;
+  assert(equal(b, "340282366920938463463374607431768211456"));
+
+  // steady-state accumulation reuses the same limb buffer
+  a = 0;
+  b = "123456789012345678901234567890";
+  a += b;
+  a.limbs.reserve(4);
+  const CBigInt::limb_t *buffer = a.limbs.data();
+  for (int i = 0; i < 1000; i++)
+    a += b;
+  assert(a.limbs.data() == buffer);
+  assert(equal(a, "123580245801358024580135802457890"));
+
+  // values up to two limbs stay inline, overflow promotes
+  a = LLONG_MIN;
+  assert(equal(a, "-9223372036854775808"));
+  a *= 3;
+  assert(equal(a, "-27670116110564327424"));
+  assert(a.limbs.isInline());
+  a = "18446744073709551615";
+  a *= a;
+  assert(equal(a, "340282366920938463426481119284349108225"));
+  assert(a.limbs.isInline());
+  a += "36893488147419103231";
+  assert(equal(a, "340282366920938463463374607431768211456"));
+  assert(!a.limbs.isInline());
+  a -= a - 1;
+  assert(equal(a, "1"));
+  a = 5;
+  a -= 12;
+  assert(equal(a, "-7"));
+  a += 7;
+  assert(equal(a, "0"));
+  a = 0u;
+  assert(equal(a, "0"));
+  a += size_t(7);
+  assert(equal(a, "7"));
+  a = ULLONG_MAX;
+  assert(equal(a, "18446744073709551615"));
+  a -= ULLONG_MAX;
+  assert(equal(a, "0"));
+
+  std::vector<int> terms;
+  for (int i = 1; i <= 3000; i++)
+    terms.push_back(i);
+  b = 1;
+  for (int term : terms)
+    b *= term;
+  assert(CBigInt::product(terms, 4) == b);
+  assert(CBigInt::product(terms.begin(), terms.end(), 1) == b);
+  assert(CBigInt::product(std::vector<CBigInt>()) == 1);
+  assert(equal(CBigInt::sum(terms, 3), "4501500"));
+  assert(equal(CBigInt::sum(std::vector<CBigInt>{"-18446744073709551616", 1, "18446744073709551615"}, 2), "0"));
+
+  // operands large enough for the parallel Toom-3 split
+  a = pow(CBigInt(3), 130000) + 1;
+  b = pow(CBigInt(7), 90000) - 1;
+  assert(CBigInt::product(std::vector<CBigInt>{a, b}, 2) == a * b);
+  assert(CBigInt::product(std::vector<CBigInt>{a, b}, 8) == a * b);
+
+  a = 100;
+  assert(equal(a / 7, "14"));
+  assert(equal(a % 7, "2"));
+  assert(equal(-a / 7, "-14"));
+  assert(equal(-a % 7, "-2"));
+  assert(equal(a % -7, "2"));
+  a = "10000000000000000000000000000000000012345";
+  b = "987654321987654321987";
+  assert(equal(a / b, "10124999989748437500"));
+  assert(equal(a % b, "133187510244854699845"));
+  assert(a / b * b + a % b == a);
+  a /= 10;
+  assert(equal(a, "1000000000000000000000000000000000001234"));
+  a %= 1000;
+  assert(equal(a, "234"));
+  try
+  {
+    a = a / 0;
+    assert("missing an exception" == nullptr);
+  }
+  catch (const std::invalid_argument &e)
+  {
+    assert(equal(a, "234"));
+  }
+
+  assert(equal(pow(CBigInt(2), 200), "1606938044258990275541962092341162602522202993782792835301376"));
+  assert(equal(pow(CBigInt(-5), 3), "-125"));
+  assert(equal(pow(CBigInt(-5), 0), "1"));
+  a = pow(CBigInt(2), 521) - 1;
+  assert(equal(powmod(3, a - 1, a), "1"));
+  CBigInt::CMontgomery mersenne(a);
+  assert(equal(mersenne.powmod(3, a - 1), "1"));
+  assert(mersenne.powmod(-1, 3) == a - 1);
+  assert(equal(powmod(CBigInt(123456789), "1000000000000000000000000000007", "100000000000000000000"), "37075660656881926429"));
+
+  is.clear();
+  is.str("0000000000000000000000012345678901234567890123456789 42");
+  assert(is >> a);
+  assert(equal(a, "12345678901234567890123456789"));
+  assert(is >> b);
+  assert(equal(b, "42"));
+  assert(is.eof());
+  is.clear();
+  is.str("123-456");
+  assert(is >> a);
+  assert(equal(a, "123"));
+  assert(is.get() == '-');
+
+  a = "-" + digits;
+  std::vector<char> printed(a.printBound());
+  size_t printedLen = a.print(printed.data());
+  assert(printedLen <= printed.size());
+  assert(std::string(printed.data(), printedLen) == "-" + digits);
+  assert(a.size() == (int)digits.size());
+  a = "-0000";
+  assert(equal(a, "0"));
+  assert(a.print(printed.data()) == 1 && printed[0] == '0');
+
   return EXIT_SUCCESS;
 }
+#endif /* CBIGINT_BENCHMARK */
 #endif /* __PROGTEST__ */
@@ -8,6 +8,14 @@
 #include <iomanip>
 #include <memory>
 #include <stdexcept>
+#include <cstdint>
+#include <string>
+#include <algorithm>
+#include <iterator>
+#include <string_view>
+#include <vector>
+#include <sstream>
+#include <map>
 #endif /* __PROGTEST__ */
 
 class CString
@@ -107,6 +115,109 @@ std::ostream &operator<<(std::ostream &os, const CString &src)
 
 // -------------------------------- //
 
+// append-only text storage for CPatchStr, meant for one thread
+// strings built on a pool pin the oldest epoch they may reference, whole blocks of older epochs are freed by reclaim()
+// the pool has to outlive every string built on it
+class CStringPool
+{
+public:
+  static constexpr size_t BLOCK_SIZE = 1 << 16;
+
+  CStringPool();
+  CStringPool(const CStringPool &src) = delete;
+  CStringPool &operator=(const CStringPool &src) = delete;
+  // room for len characters, returns their offset within the block stored to base
+  size_t allocate(size_t len, char *&base);
+  size_t epoch() const;
+  // text stored from now on goes to fresh blocks of the next epoch
+  void advanceEpoch();
+  // frees blocks of epochs no string pins any more, returns the freed bytes
+  size_t reclaim();
+  size_t blockCount() const;
+
+private:
+  friend class CPatchStr;
+
+  struct SBlock
+  {
+    std::unique_ptr<char[]> m_data;
+    size_t m_used;
+    size_t m_capacity;
+    size_t m_epoch;
+  };
+
+  // ordered by epoch
+  std::vector<SBlock> m_blocks;
+  // epoch -> number of strings pinning it
+  std::map<size_t, size_t> m_pins;
+  size_t m_epoch;
+
+  void pin(size_t epoch);
+  void unpin(size_t epoch);
+};
+
+// -------------------------------- //
+
+CStringPool::CStringPool() : m_epoch(0) {}
+
+size_t CStringPool::allocate(size_t len, char *&base)
+{
+  if (m_blocks.empty() || m_blocks.back().m_epoch != m_epoch || m_blocks.back().m_capacity - m_blocks.back().m_used < len)
+  {
+    size_t capacity = std::max(len, BLOCK_SIZE);
+    m_blocks.push_back(SBlock{std::make_unique<char[]>(capacity), 0, capacity, m_epoch});
+  }
+
+  SBlock &block = m_blocks.back();
+  size_t offset = block.m_used;
+  block.m_used += len;
+  base = block.m_data.get();
+  return offset;
+}
+
+size_t CStringPool::epoch() const
+{
+  return m_epoch;
+}
+
+void CStringPool::advanceEpoch()
+{
+  ++m_epoch;
+}
+
+size_t CStringPool::reclaim()
+{
+  size_t limit = m_pins.empty() ? m_epoch : std::min(m_epoch, m_pins.begin()->first);
+  size_t freed = 0, kept = 0;
+  for (; kept < m_blocks.size() && m_blocks[kept].m_epoch < limit; ++kept)
+  {
+    freed += m_blocks[kept].m_capacity;
+  }
+  m_blocks.erase(m_blocks.begin(), m_blocks.begin() + kept);
+  return freed;
+}
+
+size_t CStringPool::blockCount() const
+{
+  return m_blocks.size();
+}
+
+void CStringPool::pin(size_t epoch)
+{
+  ++m_pins[epoch];
+}
+
+void CStringPool::unpin(size_t epoch)
+{
+  auto it = m_pins.find(epoch);
+  if (--it->second == 0)
+  {
+    m_pins.erase(it);
+  }
+}
+
+// -------------------------------- //
+
 class CPatchStr
 {
 private:
@@ -114,15 +225,21 @@ private:
   {
     size_t m_offset;
     size_t m_length;
+    // owning buffer, empty for pool text which the pool keeps alive
     std::shared_ptr<CString> m_ptr;
+    // start of the buffer or pool block
+    const char *m_base;
 
-    SPatch() : m_offset(0), m_length(0) {}
+    SPatch() : m_offset(0), m_length(0), m_base(nullptr) {}
 
     SPatch(size_t offset, size_t length, std::shared_ptr<CString> ptr)
-        : m_offset(offset), m_length(length), m_ptr(ptr) {}
+        : m_offset(offset), m_length(length), m_ptr(ptr), m_base(ptr->toStr()) {}
+
+    SPatch(size_t offset, size_t length, const char *base)
+        : m_offset(offset), m_length(length), m_base(base) {}
 
     SPatch(const SPatch &other)
-        : m_offset(other.m_offset), m_length(other.m_length), m_ptr(other.m_ptr) {}
+        : m_offset(other.m_offset), m_length(other.m_length), m_ptr(other.m_ptr), m_base(other.m_base) {}
 
     SPatch &operator=(const SPatch &other)
     {
@@ -131,71 +248,126 @@ private:
         m_offset = other.m_offset;
         m_length = other.m_length;
         m_ptr = other.m_ptr;
+        m_base = other.m_base;
       }
       return *this;
     }
 
-    void print() const
+    const char *data() const
     {
-      std::cout << "ofs: " << m_offset << " len: " << m_length << " ptr: " << m_ptr << " " << m_ptr->toStr() << std::endl;
+      return m_base + m_offset;
     }
-  };
-
-  size_t m_size;
-  size_t m_capacity;
-  size_t m_length;
-  SPatch *m_patches;
 
-  void insert_patch(size_t pos, const SPatch &patch)
-  {
-    size_t new_size = m_size + 1;
-    if (new_size > m_capacity)
+    SPatch slice(size_t from, size_t len) const
     {
-      m_capacity = std::max(m_capacity * 2, new_size);
-      SPatch *new_patches = new SPatch[m_capacity];
-
-      for (size_t i = 0; i < m_size; ++i)
-      {
-        new_patches[i] = m_patches[i];
-      }
-
-      delete[] m_patches;
-      m_patches = new_patches;
+      SPatch result(*this);
+      result.m_offset += from;
+      result.m_length = len;
+      return result;
     }
 
-    for (size_t i = m_size; i >= pos; --i)
+    void print() const
     {
-      m_patches[i] = m_patches[i - 1];
+      std::cout << "ofs: " << m_offset << " len: " << m_length << " ptr: " << (const void *)m_base << " " << std::string_view(data(), m_length) << std::endl;
     }
+  };
 
-    m_patches[pos - 1] = patch;
+  // rope node, never modified once built so subtrees can be shared between strings
+  struct SNode
+  {
+    SPatch m_patch;
+    std::shared_ptr<const SNode> m_left;
+    std::shared_ptr<const SNode> m_right;
+    // characters and patches in the whole subtree
+    size_t m_length;
+    size_t m_count;
+  };
 
-    m_length += 1;
-    m_size = new_size;
-  }
-  void split_patch(size_t pos)
+  using NodePtr = std::shared_ptr<const SNode>;
+
+  NodePtr m_root;
+  // pool holding (part of) the text and the epoch pinned in it
+  CStringPool *m_pool;
+  size_t m_epoch;
+
+  static size_t lengthOf(const NodePtr &node);
+  static size_t countOf(const NodePtr &node);
+  static NodePtr makeNode(const SPatch &patch, const NodePtr &left, const NodePtr &right);
+  // random choice weighted by patch counts, keeps the tree balanced even when merging shared subtrees
+  static bool pickLeft(size_t leftCount, size_t rightCount);
+  static NodePtr merge(const NodePtr &left, const NodePtr &right);
+  // merge that fuses the two patches meeting at the seam when they continue each other in one buffer
+  static NodePtr join(const NodePtr &left, const NodePtr &right);
+  // splits so that left holds the first pos characters, left and right must not alias node
+  static void split(const NodePtr &node, size_t pos, NodePtr &left, NodePtr &right);
+  static size_t copyChars(const NodePtr &node, char *dst);
+  static void printNode(const NodePtr &node);
+  // takes over the pool pin of src when src references pool text
+  void adoptPool(const CPatchStr &src);
+
+  // finds a pattern inside one contiguous piece of text
+  class CSearcher
   {
-    size_t total_characters = 0;
-    size_t i = 0;
-    while (i < m_size)
-    {
-      if (total_characters + m_patches[i].m_length >= pos)
-      {
-        size_t pivot = pos - total_characters;
-        SPatch new_patch = SPatch{pivot, m_patches[i].m_length - pivot, m_patches[i].m_ptr};
-        m_patches[i].m_length = pivot;
+  public:
+    // shorter patterns only prefilter on the first byte with memchr, longer ones use Horspool
+    static constexpr size_t HORSPOOL_LENGTH = 4;
+
+    CSearcher(std::string_view pattern);
+    size_t size() const;
+    // first occurrence starting at from or later, npos when there is none
+    size_t next(std::string_view text, size_t from) const;
+
+  private:
+    std::string_view m_pattern;
+    size_t m_shift[256];
+  };
 
-        insert_patch(i + 2, new_patch);
-        break;
-      }
-      total_characters += m_patches[i++].m_length;
-    }
-  }
+  // rfind searches backwards in windows of this many characters
+  static constexpr size_t RFIND_WINDOW = 4096;
+
+  // reports occurrences starting in [from, to - pattern length] in increasing order, found returns false to stop
+  template <typename TFound>
+  void scan(const CSearcher &searcher, size_t from, size_t to, TFound &&found) const;
 
 public:
+  // compact() rewrites the string once patches get shorter than this on average
+  static constexpr size_t COMPACT_PATCH_LENGTH = 32;
+  static constexpr size_t npos = static_cast<size_t>(-1);
+
+  class CBatch;
+
+  // walks the patches in order as views into the shared buffers, valid while the string is unchanged
+  class CChunkIterator
+  {
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = std::string_view;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const std::string_view *;
+    using reference = std::string_view;
+
+    CChunkIterator() : m_skip(0) {}
+    std::string_view operator*() const;
+    CChunkIterator &operator++();
+    CChunkIterator operator++(int);
+    bool operator==(const CChunkIterator &other) const;
+    bool operator!=(const CChunkIterator &other) const;
+
+  private:
+    friend class CPatchStr;
+    // top is the current node, the rest are ancestors still waiting for their patch
+    std::vector<const SNode *> m_stack;
+    // characters of the current patch skipped when starting mid patch
+    size_t m_skip;
+
+    CChunkIterator(const SNode *root, size_t from);
+    void pushLeft(const SNode *node);
+  };
+
   CPatchStr();
   CPatchStr(const char *str);
-  CPatchStr(const SPatch &src);
+  // copies str into the pool instead of a buffer of its own
+  CPatchStr(const char *str, CStringPool &pool);
   CPatchStr(const CPatchStr &src);
   ~CPatchStr();
   // operator =
@@ -206,57 +378,476 @@ public:
   CPatchStr &insert(size_t pos, const CPatchStr &src);
   CPatchStr &remove(size_t from, size_t len);
   char *toStr() const;
+  size_t length() const;
+  // fragmentation counters
+  size_t patchCount() const;
+  size_t averagePatchLength() const;
+  // copies everything into one fresh buffer when fragmented (or always with force), returns whether it did
+  bool compact(bool force = false);
+
+  // chunk starting at character from (or end when from is the length)
+  CChunkIterator chunksBegin(size_t from = 0) const;
+  CChunkIterator chunksEnd() const;
+  template <typename TCallback>
+  void forEachChunk(TCallback &&callback) const;
+  std::ostream &writeTo(std::ostream &os) const;
+  // copies len characters starting at from into dst, no terminator is added
+  void copyTo(char *dst, size_t from, size_t len) const;
+
+  // occurrences of pattern, count and replaceAll take them left to right without overlaps
+  size_t find(const char *pattern, size_t from = 0) const;
+  size_t rfind(const char *pattern, size_t from = npos) const;
+  size_t count(const char *pattern) const;
+  // splices replacement in place of every occurrence, returns how many were replaced
+  size_t replaceAll(const char *pattern, const CPatchStr &replacement);
+
+  void print() const;
+};
+
+// -------------------------------- //
+
+// edits collected against one string and applied together, positions refer to the string before commit()
+// overlapping removes are merged, inserts at one position keep their order and an insert inside a removed range lands at its start
+// the inverse edits are kept so undo() and redo() cost O(edits log n) as long as nothing else changes the string
+class CPatchStr::CBatch
+{
+public:
+  CBatch(CPatchStr &target);
+  CBatch &insert(size_t pos, const CPatchStr &src);
+  CBatch &remove(size_t from, size_t len);
+  size_t size() const;
+  void commit();
+  void undo();
+  void redo();
 
-  void print() const
+private:
+  struct SEdit
   {
-    for (size_t i = 0; i < m_size; ++i)
+    size_t m_pos;
+    // removed characters, zero for an insert
+    size_t m_removed;
+    CPatchStr m_text;
+  };
+
+  CPatchStr &m_target;
+  std::vector<SEdit> m_edits;
+  std::vector<SEdit> m_inverse;
+  // target contents right after the last commit, undo or redo
+  NodePtr m_expected;
+  bool m_committed;
+  bool m_undone;
+
+  // applies sorted edits in one pass over the target and returns their inverse
+  std::vector<SEdit> run(const std::vector<SEdit> &edits);
+  void checkTarget() const;
+};
+
+// -------------------------------- //
+
+CPatchStr::CChunkIterator::CChunkIterator(const SNode *root, size_t from) : m_skip(0)
+{
+  const SNode *node = root;
+  while (node)
+  {
+    size_t leftLength = lengthOf(node->m_left);
+    if (from < leftLength)
+    {
+      m_stack.push_back(node);
+      node = node->m_left.get();
+    }
+    else if (from < leftLength + node->m_patch.m_length)
     {
-      m_patches[i].print();
+      m_stack.push_back(node);
+      m_skip = from - leftLength;
+      break;
+    }
+    else
+    {
+      from -= leftLength + node->m_patch.m_length;
+      node = node->m_right.get();
     }
   }
-};
+}
+
+void CPatchStr::CChunkIterator::pushLeft(const SNode *node)
+{
+  for (; node; node = node->m_left.get())
+  {
+    m_stack.push_back(node);
+  }
+}
+
+std::string_view CPatchStr::CChunkIterator::operator*() const
+{
+  const SPatch &patch = m_stack.back()->m_patch;
+  return std::string_view(patch.data() + m_skip, patch.m_length - m_skip);
+}
+
+CPatchStr::CChunkIterator &CPatchStr::CChunkIterator::operator++()
+{
+  const SNode *node = m_stack.back();
+  m_stack.pop_back();
+  m_skip = 0;
+  pushLeft(node->m_right.get());
+  return *this;
+}
+
+CPatchStr::CChunkIterator CPatchStr::CChunkIterator::operator++(int)
+{
+  CChunkIterator old = *this;
+  ++*this;
+  return old;
+}
+
+bool CPatchStr::CChunkIterator::operator==(const CChunkIterator &other) const
+{
+  // a shared node can sit at several positions, the ancestors tell them apart
+  return m_skip == other.m_skip && m_stack == other.m_stack;
+}
+
+bool CPatchStr::CChunkIterator::operator!=(const CChunkIterator &other) const
+{
+  return !(*this == other);
+}
+
+template <typename TCallback>
+void CPatchStr::forEachChunk(TCallback &&callback) const
+{
+  for (CChunkIterator it = chunksBegin(); it != chunksEnd(); ++it)
+  {
+    callback(*it);
+  }
+}
+
+// -------------------------------- //
+
+CPatchStr::CSearcher::CSearcher(std::string_view pattern) : m_pattern(pattern)
+{
+  std::fill(std::begin(m_shift), std::end(m_shift), pattern.size());
+  for (size_t i = 0; i + 1 < pattern.size(); ++i)
+  {
+    m_shift[static_cast<unsigned char>(pattern[i])] = pattern.size() - 1 - i;
+  }
+}
+
+size_t CPatchStr::CSearcher::size() const
+{
+  return m_pattern.size();
+}
+
+size_t CPatchStr::CSearcher::next(std::string_view text, size_t from) const
+{
+  size_t m = m_pattern.size();
+  if (text.size() < m || from > text.size() - m)
+  {
+    return npos;
+  }
+
+  if (m < HORSPOOL_LENGTH)
+  {
+    const char *pos = text.data() + from;
+    const char *end = text.data() + text.size() - m + 1;
+    while (pos < end)
+    {
+      pos = static_cast<const char *>(std::memchr(pos, m_pattern[0], end - pos));
+      if (!pos)
+      {
+        return npos;
+      }
+      if (std::memcmp(pos + 1, m_pattern.data() + 1, m - 1) == 0)
+      {
+        return pos - text.data();
+      }
+      ++pos;
+    }
+    return npos;
+  }
+
+  char last = m_pattern[m - 1];
+  for (size_t i = from; i <= text.size() - m; i += m_shift[static_cast<unsigned char>(text[i + m - 1])])
+  {
+    if (text[i + m - 1] == last && std::memcmp(text.data() + i, m_pattern.data(), m - 1) == 0)
+    {
+      return i;
+    }
+  }
+  return npos;
+}
+
+template <typename TFound>
+void CPatchStr::scan(const CSearcher &searcher, size_t from, size_t to, TFound &&found) const
+{
+  size_t m = searcher.size();
+  if (to - from < m)
+  {
+    return;
+  }
+
+  // last m - 1 characters before the current chunk, matches crossing the seam are searched in carry + chunk start
+  std::string carry, seam;
+  size_t pos = from;
+  for (CChunkIterator it = chunksBegin(from); pos < to; ++it)
+  {
+    std::string_view chunk = (*it).substr(0, to - pos);
+
+    if (!carry.empty())
+    {
+      seam = carry;
+      seam.append(chunk.substr(0, m - 1));
+      for (size_t s = searcher.next(seam, 0); s != npos && s < carry.size(); s = searcher.next(seam, s + 1))
+      {
+        if (!found(pos - carry.size() + s))
+        {
+          return;
+        }
+      }
+    }
+
+    for (size_t s = searcher.next(chunk, 0); s != npos; s = searcher.next(chunk, s + 1))
+    {
+      if (!found(pos + s))
+      {
+        return;
+      }
+    }
+
+    if (chunk.size() >= m - 1)
+    {
+      carry.assign(chunk.substr(chunk.size() - (m - 1)));
+    }
+    else
+    {
+      carry.append(chunk);
+      carry.erase(0, carry.size() - std::min(carry.size(), m - 1));
+    }
+    pos += chunk.size();
+  }
+}
 
 // -------------------------------- //
-CPatchStr::CPatchStr() : m_size(0), m_capacity(1), m_length(0), m_patches(new SPatch[1]) {}
 
-CPatchStr::CPatchStr(const char *str) : m_size(1), m_capacity(1), m_length(strlen(str)), m_patches(new SPatch[1])
+size_t CPatchStr::lengthOf(const NodePtr &node)
 {
-  m_patches[0].m_offset = 0;
-  m_patches[0].m_length = m_length;
-  m_patches[0].m_ptr = std::make_shared<CString>(str);
+  return node ? node->m_length : 0;
 }
 
-CPatchStr::CPatchStr(const SPatch &src) : m_size(1), m_capacity(1), m_length(src.m_length), m_patches(new SPatch[1])
+size_t CPatchStr::countOf(const NodePtr &node)
 {
-  m_patches[0] = src;
+  return node ? node->m_count : 0;
 }
 
-CPatchStr::CPatchStr(const CPatchStr &src) : m_size(src.m_size), m_capacity(src.m_capacity), m_length(src.m_length), m_patches(new SPatch[src.m_capacity])
+CPatchStr::NodePtr CPatchStr::makeNode(const SPatch &patch, const NodePtr &left, const NodePtr &right)
 {
-  for (size_t i = 0; i < m_size; ++i)
+  return std::make_shared<const SNode>(SNode{patch, left, right,
+                                             patch.m_length + lengthOf(left) + lengthOf(right),
+                                             1 + countOf(left) + countOf(right)});
+}
+
+bool CPatchStr::pickLeft(size_t leftCount, size_t rightCount)
+{
+  // xorshift is enough, only the shape of the tree depends on it
+  static thread_local uint64_t state = 0x9e3779b97f4a7c15ULL;
+  state ^= state << 13;
+  state ^= state >> 7;
+  state ^= state << 17;
+  return state % (leftCount + rightCount) < leftCount;
+}
+
+CPatchStr::NodePtr CPatchStr::merge(const NodePtr &left, const NodePtr &right)
+{
+  if (!left)
+  {
+    return right;
+  }
+  if (!right)
+  {
+    return left;
+  }
+
+  if (pickLeft(left->m_count, right->m_count))
+  {
+    return makeNode(left->m_patch, left->m_left, merge(left->m_right, right));
+  }
+  return makeNode(right->m_patch, merge(left, right->m_left), right->m_right);
+}
+
+CPatchStr::NodePtr CPatchStr::join(const NodePtr &left, const NodePtr &right)
+{
+  if (!left || !right)
+  {
+    return merge(left, right);
+  }
+
+  const SNode *last = left.get();
+  while (last->m_right)
+  {
+    last = last->m_right.get();
+  }
+  const SNode *first = right.get();
+  while (first->m_left)
+  {
+    first = first->m_left.get();
+  }
+
+  const SPatch &lastPatch = last->m_patch;
+  const SPatch &firstPatch = first->m_patch;
+  if (lastPatch.m_base != firstPatch.m_base || lastPatch.m_offset + lastPatch.m_length != firstPatch.m_offset)
+  {
+    return merge(left, right);
+  }
+
+  NodePtr head, lastNode, firstNode, tail;
+  split(left, left->m_length - lastPatch.m_length, head, lastNode);
+  split(right, firstPatch.m_length, firstNode, tail);
+  SPatch fused = lastPatch.slice(0, lastPatch.m_length + firstPatch.m_length);
+  return merge(merge(head, makeNode(fused, nullptr, nullptr)), tail);
+}
+
+void CPatchStr::split(const NodePtr &node, size_t pos, NodePtr &left, NodePtr &right)
+{
+  if (pos == 0)
+  {
+    left = nullptr;
+    right = node;
+    return;
+  }
+  if (pos >= lengthOf(node))
+  {
+    left = node;
+    right = nullptr;
+    return;
+  }
+
+  const SPatch &patch = node->m_patch;
+  size_t leftLength = lengthOf(node->m_left);
+  NodePtr rest;
+
+  if (pos <= leftLength)
+  {
+    split(node->m_left, pos, left, rest);
+    right = makeNode(patch, rest, node->m_right);
+  }
+  else if (pos >= leftLength + patch.m_length)
+  {
+    split(node->m_right, pos - leftLength - patch.m_length, rest, right);
+    left = makeNode(patch, node->m_left, rest);
+  }
+  else
+  {
+    // cut inside this patch, both halves keep pointing to the same buffer
+    size_t cut = pos - leftLength;
+    left = makeNode(patch.slice(0, cut), node->m_left, nullptr);
+    right = makeNode(patch.slice(cut, patch.m_length - cut), nullptr, node->m_right);
+  }
+}
+
+size_t CPatchStr::copyChars(const NodePtr &node, char *dst)
+{
+  if (!node)
+  {
+    return 0;
+  }
+
+  size_t done = copyChars(node->m_left, dst);
+  const SPatch &patch = node->m_patch;
+  std::memcpy(dst + done, patch.data(), patch.m_length);
+  done += patch.m_length;
+  return done + copyChars(node->m_right, dst + done);
+}
+
+void CPatchStr::printNode(const NodePtr &node)
+{
+  if (node)
+  {
+    printNode(node->m_left);
+    node->m_patch.print();
+    printNode(node->m_right);
+  }
+}
+
+// -------------------------------- //
+
+void CPatchStr::adoptPool(const CPatchStr &src)
+{
+  if (!src.m_pool)
+  {
+    return;
+  }
+  if (!m_pool)
+  {
+    m_pool = src.m_pool;
+    m_epoch = src.m_epoch;
+    m_pool->pin(m_epoch);
+  }
+  else if (m_pool != src.m_pool)
+  {
+    throw std::invalid_argument("Strings from different pools can't be mixed.");
+  }
+  else if (src.m_epoch < m_epoch)
   {
-    m_patches[i] = src.m_patches[i];
+    m_pool->pin(src.m_epoch);
+    m_pool->unpin(m_epoch);
+    m_epoch = src.m_epoch;
+  }
+}
+
+// -------------------------------- //
+
+CPatchStr::CPatchStr() : m_pool(nullptr), m_epoch(0) {}
+
+CPatchStr::CPatchStr(const char *str) : m_pool(nullptr), m_epoch(0)
+{
+  size_t length = strlen(str);
+  if (length)
+  {
+    m_root = makeNode(SPatch{0, length, std::make_shared<CString>(str)}, nullptr, nullptr);
+  }
+}
+
+CPatchStr::CPatchStr(const char *str, CStringPool &pool) : m_pool(&pool), m_epoch(pool.epoch())
+{
+  m_pool->pin(m_epoch);
+  size_t length = strlen(str);
+  if (length)
+  {
+    char *base;
+    size_t offset = m_pool->allocate(length, base);
+    std::memcpy(base + offset, str, length);
+    m_root = makeNode(SPatch{offset, length, base}, nullptr, nullptr);
+  }
+}
+
+CPatchStr::CPatchStr(const CPatchStr &src) : m_root(src.m_root), m_pool(src.m_pool), m_epoch(src.m_epoch)
+{
+  if (m_pool)
+  {
+    m_pool->pin(m_epoch);
   }
 }
 
 CPatchStr::~CPatchStr()
 {
-  delete[] m_patches;
+  if (m_pool)
+  {
+    m_pool->unpin(m_epoch);
+  }
 }
 
 CPatchStr &CPatchStr::operator=(const CPatchStr &src)
 {
   if (this != &src)
   {
-    delete[] m_patches;
-    m_size = src.m_size;
-    m_capacity = src.m_capacity;
-    m_length = src.m_length;
-    m_patches = new SPatch[m_capacity];
-    for (size_t i = 0; i < m_size; ++i)
+    if (src.m_pool)
+    {
+      src.m_pool->pin(src.m_epoch);
+    }
+    if (m_pool)
     {
-      m_patches[i] = src.m_patches[i];
+      m_pool->unpin(m_epoch);
     }
+    m_root = src.m_root;
+    m_pool = src.m_pool;
+    m_epoch = src.m_epoch;
   }
   return *this;
 }
@@ -268,194 +859,432 @@ CPatchStr CPatchStr::subStr(size_t from, size_t len) const
     return {};
   }
 
-  if (from + len > m_length)
+  if (from > length() || len > length() - from)
   {
     throw std::out_of_range("from + len greater than this length.");
   }
 
+  NodePtr head, rest, tail;
   CPatchStr result;
+  result.adoptPool(*this);
+  split(m_root, from, head, rest);
+  split(rest, len, result.m_root, tail);
+  return result;
+}
+
+CPatchStr &CPatchStr::append(const CPatchStr &src)
+{
+  adoptPool(src);
+  m_root = join(m_root, src.m_root);
+  return *this;
+}
 
-  size_t num_of_characters_passed = 0;
-  size_t num_of_characters_taken = 0;
-  bool first = true;
-  for (size_t i = 0; i < m_size; ++i)
+CPatchStr &CPatchStr::insert(size_t pos, const CPatchStr &src)
+{
+  if (pos > length())
   {
-    auto patch_data = m_patches[i];
-    // if we can start
-    if (num_of_characters_passed + (patch_data.m_length) >= from)
-    {
-      if (num_of_characters_taken == len)
-      {
-        break;
-      }
-      if (first)
-      {
-        size_t offset = from - num_of_characters_passed;
-        size_t available_chars = patch_data.m_length - offset;
+    throw std::out_of_range("Position is out of range.");
+  }
 
-        if (len >= available_chars)
-        {
-          result.append(CPatchStr{SPatch{offset, available_chars, patch_data.m_ptr}});
-          num_of_characters_taken += available_chars;
-        }
-        else
-        {
-          size_t num_chars_needed = len - num_of_characters_taken;
-          result.append(CPatchStr{SPatch{offset, num_chars_needed, patch_data.m_ptr}});
-          num_of_characters_taken += num_chars_needed;
-        }
-        first = false;
-      }
-      else
-      {
-        size_t available_chars = patch_data.m_length;
-        size_t num_chars_needed = len - num_of_characters_taken;
-        int num_chars_to_take = num_chars_needed - available_chars;
+  adoptPool(src);
+  NodePtr head, tail;
+  split(m_root, pos, head, tail);
+  m_root = join(join(head, src.m_root), tail);
+  return *this;
+}
 
-        if (num_chars_to_take >= 0)
-        {
-          result.append(CPatchStr{SPatch{patch_data.m_offset, patch_data.m_length, patch_data.m_ptr}});
-          num_of_characters_taken += patch_data.m_length;
-        }
-        else
-        {
-          result.append(CPatchStr{SPatch{patch_data.m_offset, num_chars_needed, patch_data.m_ptr}});
-          num_of_characters_taken += num_chars_needed;
-        }
-      }
-    }
-    num_of_characters_passed += patch_data.m_length;
+CPatchStr &CPatchStr::remove(size_t from, size_t len)
+{
+  if (from > length() || len > length() - from)
+  {
+    throw std::out_of_range("Length of characters to remove doesnt fit.");
   }
 
+  if (len == 0)
+  {
+    return *this;
+  }
+
+  NodePtr head, rest, middle, tail;
+  split(m_root, from, head, rest);
+  split(rest, len, middle, tail);
+  m_root = join(head, tail);
+  return *this;
+}
+
+char *CPatchStr::toStr() const
+{
+  char *result = new char[length() + 1];
+  result[copyChars(m_root, result)] = '\0';
   return result;
 }
 
-CPatchStr &CPatchStr::append(const CPatchStr &src)
+size_t CPatchStr::length() const
+{
+  return lengthOf(m_root);
+}
+
+size_t CPatchStr::patchCount() const
+{
+  return countOf(m_root);
+}
+
+size_t CPatchStr::averagePatchLength() const
+{
+  return m_root ? m_root->m_length / m_root->m_count : 0;
+}
+
+bool CPatchStr::compact(bool force)
 {
-  size_t new_size = m_size + src.m_size;
+  if (!m_root || (!force && (patchCount() == 1 || averagePatchLength() >= COMPACT_PATCH_LENGTH)))
+  {
+    return false;
+  }
 
-  if (new_size > m_capacity)
+  size_t len = length();
+  if (m_pool)
   {
-    m_capacity = std::max(m_capacity * 2, new_size);
-    SPatch *new_patches = new SPatch[m_capacity];
+    // the copy lives in the current epoch, so older blocks are no longer pinned by this string
+    char *base;
+    size_t offset = m_pool->allocate(len, base);
+    copyChars(m_root, base + offset);
+    m_root = makeNode(SPatch{offset, len, base}, nullptr, nullptr);
+    m_pool->pin(m_pool->epoch());
+    m_pool->unpin(m_epoch);
+    m_epoch = m_pool->epoch();
+    return true;
+  }
 
-    for (size_t i = 0; i < m_size; ++i)
-    {
-      new_patches[i] = m_patches[i];
-    }
+  char *buffer = toStr();
+  m_root = makeNode(SPatch{0, len, std::make_shared<CString>(buffer)}, nullptr, nullptr);
+  delete[] buffer;
+  return true;
+}
 
-    delete[] m_patches;
-    m_patches = new_patches;
+CPatchStr::CChunkIterator CPatchStr::chunksBegin(size_t from) const
+{
+  if (from > length())
+  {
+    throw std::out_of_range("Position is out of range.");
   }
+  return CChunkIterator(m_root.get(), from);
+}
 
-  for (size_t i = 0; i < src.m_size; ++i)
+CPatchStr::CChunkIterator CPatchStr::chunksEnd() const
+{
+  return CChunkIterator();
+}
+
+std::ostream &CPatchStr::writeTo(std::ostream &os) const
+{
+  forEachChunk([&os](std::string_view chunk)
+               { os.write(chunk.data(), chunk.size()); });
+  return os;
+}
+
+void CPatchStr::copyTo(char *dst, size_t from, size_t len) const
+{
+  if (from > length() || len > length() - from)
   {
-    m_patches[m_size + i] = src.m_patches[i];
+    throw std::out_of_range("from + len greater than this length.");
   }
 
-  m_length += src.m_length;
-  m_size = new_size;
-  return *this;
+  for (CChunkIterator it = chunksBegin(from); len; ++it)
+  {
+    std::string_view chunk = *it;
+    size_t take = std::min(len, chunk.size());
+    std::memcpy(dst, chunk.data(), take);
+    dst += take;
+    len -= take;
+  }
 }
 
-CPatchStr &CPatchStr::insert(size_t pos, const CPatchStr &src)
+size_t CPatchStr::find(const char *pattern, size_t from) const
 {
-  if (pos == m_length)
+  size_t len = length();
+  if (from > len)
   {
-    return append(src);
+    return npos;
   }
-  if (pos > m_length)
+  if (!*pattern)
   {
-    throw std::out_of_range("Position is out of range.");
+    return from;
+  }
+
+  size_t result = npos;
+  scan(CSearcher(pattern), from, len, [&result](size_t pos)
+       { result = pos; return false; });
+  return result;
+}
+
+size_t CPatchStr::rfind(const char *pattern, size_t from) const
+{
+  size_t len = length();
+  size_t m = strlen(pattern);
+  if (m > len)
+  {
+    return npos;
+  }
+
+  size_t lastStart = std::min(from, len - m);
+  if (m == 0)
+  {
+    return lastStart;
+  }
+
+  CSearcher searcher(pattern);
+  size_t window = std::max(RFIND_WINDOW, 2 * m);
+  size_t end = lastStart + m;
+  while (true)
+  {
+    size_t begin = end > window ? end - window : 0;
+    size_t result = npos;
+    scan(searcher, begin, end, [&result](size_t pos)
+         { result = pos; return true; });
+    if (result != npos)
+    {
+      return result;
+    }
+    if (begin == 0)
+    {
+      return npos;
+    }
+    // windows overlap so matches crossing the window border are not lost
+    end = begin + m - 1;
+  }
+}
+
+size_t CPatchStr::count(const char *pattern) const
+{
+  size_t m = strlen(pattern);
+  if (m == 0)
+  {
+    throw std::invalid_argument("Empty pattern.");
   }
 
-  split_patch(pos);
+  size_t total = 0, next = 0;
+  scan(CSearcher(pattern), 0, length(), [&](size_t pos)
+       {
+         if (pos >= next)
+         {
+           ++total;
+           next = pos + m;
+         }
+         return true; });
+  return total;
+}
+
+size_t CPatchStr::replaceAll(const char *pattern, const CPatchStr &replacement)
+{
+  size_t m = strlen(pattern);
+  if (m == 0)
+  {
+    throw std::invalid_argument("Empty pattern.");
+  }
 
-  pos += 1;
-  for (size_t i = 0; i < src.m_size; ++i)
+  std::vector<size_t> positions;
+  scan(CSearcher(pattern), 0, length(), [&](size_t pos)
+       {
+         if (positions.empty() || pos >= positions.back() + m)
+         {
+           positions.push_back(pos);
+         }
+         return true; });
+  if (positions.empty())
   {
-    insert_patch(pos + i, src.m_patches[i]);
+    return 0;
   }
 
+  // rebuild from the kept pieces and the replacement, no text is copied
+  NodePtr result, rest = m_root, keep, tail, skipped;
+  size_t done = 0;
+  for (size_t pos : positions)
+  {
+    split(rest, pos - done, keep, tail);
+    split(tail, m, skipped, rest);
+    result = join(join(result, keep), replacement.m_root);
+    done = pos + m;
+  }
+  adoptPool(replacement);
+  m_root = join(result, rest);
+  return positions.size();
+}
+
+void CPatchStr::print() const
+{
+  printNode(m_root);
+}
+// -------------------------------- //
+
+CPatchStr::CBatch::CBatch(CPatchStr &target) : m_target(target), m_committed(false), m_undone(false) {}
+
+CPatchStr::CBatch &CPatchStr::CBatch::insert(size_t pos, const CPatchStr &src)
+{
+  if (m_committed)
+  {
+    throw std::logic_error("Batch already committed.");
+  }
+  if (src.m_root)
+  {
+    m_edits.push_back(SEdit{pos, 0, src});
+  }
   return *this;
 }
 
-CPatchStr &CPatchStr::remove(size_t from, size_t len)
+CPatchStr::CBatch &CPatchStr::CBatch::remove(size_t from, size_t len)
 {
-  if (from + len > m_length)
+  if (m_committed)
+  {
+    throw std::logic_error("Batch already committed.");
+  }
+  if (from > SIZE_MAX - len)
   {
     throw std::out_of_range("Length of characters to remove doesnt fit.");
   }
+  if (len)
+  {
+    m_edits.push_back(SEdit{from, len, CPatchStr()});
+  }
+  return *this;
+}
 
-  if (len == 0)
+size_t CPatchStr::CBatch::size() const
+{
+  return m_edits.size();
+}
+
+void CPatchStr::CBatch::commit()
+{
+  if (m_committed)
   {
-    return *this;
+    throw std::logic_error("Batch already committed.");
   }
 
-  size_t total_characters = 0;
-  size_t total_deleted = 0;
-  size_t i = 0;
-  bool first = true;
-  while (i < m_size)
+  size_t len = m_target.length();
+  std::vector<SEdit> inserts, removes;
+  for (const SEdit &edit : m_edits)
   {
-    std::cout << "total characters: " << total_characters << std::endl;
-    std::cout << "total deleted: " << total_deleted << std::endl;
-    if (total_deleted == len)
+    if (edit.m_pos + edit.m_removed > len)
     {
-      break;
+      throw std::out_of_range("Edit out of range.");
     }
-    if (total_characters + m_patches[i].m_length >= from)
+    (edit.m_removed ? removes : inserts).push_back(edit);
+  }
+
+  auto byPos = [](const SEdit &a, const SEdit &b)
+  { return a.m_pos < b.m_pos; };
+  std::sort(removes.begin(), removes.end(), byPos);
+
+  // merge overlapping and touching removes
+  std::vector<SEdit> merged;
+  for (const SEdit &edit : removes)
+  {
+    if (!merged.empty() && edit.m_pos <= merged.back().m_pos + merged.back().m_removed)
     {
-      if (first)
-      {
-        size_t pivot = from - total_characters;
-        total_deleted += m_patches[i].m_length - pivot;
-        m_patches[i].m_length = pivot;
-        first = false;
-      }
-      else
-      {
-        if (m_patches[i].m_length >= (len - total_deleted))
-        {
-          m_patches[i].m_offset = (len - total_deleted);
-          total_deleted += m_patches[i].m_length;
-        }
-        else
-        {
-          total_deleted += m_patches[i].m_length;
-          m_patches[i].m_length = 0;
-        }
-      }
+      size_t end = std::max(merged.back().m_pos + merged.back().m_removed, edit.m_pos + edit.m_removed);
+      merged.back().m_removed = end - merged.back().m_pos;
+    }
+    else
+    {
+      merged.push_back(edit);
     }
-    total_characters += m_patches[i++].m_length;
   }
 
-  return *this;
+  // move inserts out of removed ranges before sorting so equal positions keep the order they were added in
+  for (SEdit &edit : inserts)
+  {
+    auto it = std::upper_bound(merged.begin(), merged.end(), edit, byPos);
+    if (it != merged.begin() && edit.m_pos < (it - 1)->m_pos + (it - 1)->m_removed)
+    {
+      edit.m_pos = (it - 1)->m_pos;
+    }
+  }
+  std::stable_sort(inserts.begin(), inserts.end(), byPos);
+
+  // interleave, inserts go before a remove starting at the same position
+  std::vector<SEdit> edits;
+  size_t r = 0;
+  for (const SEdit &edit : inserts)
+  {
+    for (; r < merged.size() && merged[r].m_pos < edit.m_pos; ++r)
+    {
+      edits.push_back(merged[r]);
+    }
+    edits.push_back(edit);
+  }
+  edits.insert(edits.end(), merged.begin() + r, merged.end());
+
+  m_edits = std::move(edits);
+  m_inverse = run(m_edits);
+  m_committed = true;
 }
 
-char *CPatchStr::toStr() const
+void CPatchStr::CBatch::undo()
+{
+  if (!m_committed || m_undone)
+  {
+    throw std::logic_error("Nothing to undo.");
+  }
+  checkTarget();
+  run(m_inverse);
+  m_undone = true;
+}
+
+void CPatchStr::CBatch::redo()
 {
-  size_t totalLength = 0;
-  for (size_t i = 0; i < m_size; ++i)
+  if (!m_undone)
   {
-    totalLength += m_patches[i].m_length;
+    throw std::logic_error("Nothing to redo.");
   }
+  checkTarget();
+  m_inverse = run(m_edits);
+  m_undone = false;
+}
 
-  char *result = new char[totalLength + 1];
+std::vector<CPatchStr::CBatch::SEdit> CPatchStr::CBatch::run(const std::vector<SEdit> &edits)
+{
+  std::vector<SEdit> inverse;
+  NodePtr result, rest = m_target.m_root, keep, tail;
+  size_t done = 0;
 
-  size_t currentIndex = 0;
-  for (size_t i = 0; i < m_size; ++i)
+  for (const SEdit &edit : edits)
   {
-    const CString *patch = m_patches[i].m_ptr.get();
-    const char *patchData = patch->toStr() + m_patches[i].m_offset;
-    std::memcpy(result + currentIndex, patchData, m_patches[i].m_length);
-    currentIndex += m_patches[i].m_length;
+    split(rest, edit.m_pos - done, keep, tail);
+    result = join(result, keep);
+    rest = tail;
+    done = edit.m_pos;
+
+    size_t pos = lengthOf(result);
+    if (edit.m_removed)
+    {
+      CPatchStr removed;
+      removed.adoptPool(m_target);
+      split(rest, edit.m_removed, removed.m_root, tail);
+      rest = tail;
+      done += edit.m_removed;
+      inverse.push_back(SEdit{pos, 0, removed});
+    }
+    else
+    {
+      m_target.adoptPool(edit.m_text);
+      result = join(result, edit.m_text.m_root);
+      inverse.push_back(SEdit{pos, edit.m_text.length(), CPatchStr()});
+    }
   }
 
-  result[currentIndex] = '\0';
+  m_target.m_root = join(result, rest);
+  m_expected = m_target.m_root;
+  return inverse;
+}
 
-  return result;
+void CPatchStr::CBatch::checkTarget() const
+{
+  if (m_target.m_root != m_expected)
+  {
+    throw std::logic_error("String changed since the batch was applied.");
+  }
 }
+
 // -------------------------------- //
 
 #ifndef __PROGTEST__
@@ -498,32 +1327,183 @@ int main()
   assert(stringMatch(d.toStr(), "t atat datfdatfoo text tex"));
 
   CPatchStr x{"test"};
-  cout << x.remove(1, 2).toStr() << endl;
-  // d.print();
-  // cout << d.toStr() << endl;
-  // cout << endl;
-  // d.remove(2, 9);
-  // cout << d.toStr() << endl;
-
-  // b = "abcdefgh";
-  // assert(stringMatch(b.toStr(), "abcdefgh"));
-  // assert(stringMatch(d.toStr(), "t atat datfdatfoo text tex"));
-  // assert(stringMatch(d.subStr(4, 8).toStr(), "at datfd"));
-  // assert(stringMatch(b.subStr(2, 6).toStr(), "cdefgh"));
-  // try
-  // {
-  //   b.subStr(2, 7).toStr();
-  //   assert("Exception not thrown" == nullptr);
-  // }
-  // catch (const std::out_of_range &e)
-  // {
-  // }
-  // catch (...)
-  // {
-  //   assert("Invalid exception thrown" == nullptr);
-  // }
-  // a.remove(3, 5);
-  // assert(stringMatch(a.toStr(), "tesa"));
+  assert(stringMatch(x.remove(1, 2).toStr(), "tt"));
+
+  b = "abcdefgh";
+  assert(stringMatch(b.toStr(), "abcdefgh"));
+  assert(stringMatch(d.toStr(), "t atat datfdatfoo text tex"));
+  assert(stringMatch(d.subStr(4, 8).toStr(), "at datfd"));
+  assert(stringMatch(b.subStr(2, 6).toStr(), "cdefgh"));
+  try
+  {
+    b.subStr(2, 7).toStr();
+    assert("Exception not thrown" == nullptr);
+  }
+  catch (const std::out_of_range &e)
+  {
+  }
+  catch (...)
+  {
+    assert("Invalid exception thrown" == nullptr);
+  }
+  a.remove(3, 5);
+  assert(stringMatch(a.toStr(), "tesa"));
+
+  // many edits against a plain string
+  CPatchStr r("0123456789");
+  std::string model = "0123456789";
+  unsigned seed = 12345;
+  for (int i = 0; i < 3000; ++i)
+  {
+    seed = seed * 1103515245 + 12345;
+    size_t pos = (seed >> 8) % (model.size() + 1);
+    size_t len = (seed >> 20) % 8;
+    if (i % 3 != 2 || len > model.size() - pos)
+    {
+      r.insert(pos, r.subStr(0, std::min(len, model.size())));
+      model.insert(pos, model.substr(0, std::min(len, model.size())));
+    }
+    else
+    {
+      r.remove(pos, len);
+      model.erase(pos, len);
+    }
+  }
+  assert(r.length() == model.size());
+  assert(stringMatch(r.toStr(), model.c_str()));
+
+  // repeated self append shares the subtrees instead of copying them
+  CPatchStr e("ab");
+  for (int i = 0; i < 20; ++i)
+  {
+    e.append(e);
+  }
+  assert(e.length() == (size_t(2) << 20));
+  assert(stringMatch(e.subStr(999999, 4).toStr(), "baba"));
+
+  // neighbouring pieces of one buffer fuse back into one patch
+  CPatchStr f("hello world");
+  f.insert(5, ",");
+  assert(f.patchCount() == 3);
+  f.remove(5, 1);
+  assert(f.patchCount() == 1);
+  assert(stringMatch(f.subStr(0, 3).append(f.subStr(3, 5)).toStr(), "hello wo"));
+  assert(f.subStr(0, 3).append(f.subStr(3, 5)).patchCount() == 1);
+  for (int i = 0; i < 10; ++i)
+  {
+    f.insert(i, "-");
+  }
+  assert(f.patchCount() == 11 && f.averagePatchLength() == 1);
+  assert(f.compact() && f.patchCount() == 1);
+  assert(stringMatch(f.toStr(), "----------hello world"));
+  assert(!f.compact() && f.compact(true) && !CPatchStr().compact(true));
+
+  // reading without materialising
+  std::string chunks;
+  size_t chunkCount = 0;
+  d.forEachChunk([&](std::string_view chunk)
+                 { chunks.append(chunk); ++chunkCount; });
+  assert(chunks == "t atat datfdatfoo text tex" && chunkCount == d.patchCount());
+  std::ostringstream oss;
+  c.writeTo(oss);
+  assert(oss.str() == "test datat datfoo text textest datat datfoo text tex");
+  std::memset(tmpStr, 0, sizeof(tmpStr));
+  d.copyTo(tmpStr, 4, 8);
+  assert(std::strcmp(tmpStr, "at datfd") == 0);
+  assert((*d.chunksBegin(1))[0] == ' ');
+  assert(d.chunksBegin(d.length()) == d.chunksEnd());
+  std::string walked;
+  for (auto it = e.chunksBegin(e.length() - 10); it != e.chunksEnd(); it++)
+  {
+    walked.append(*it);
+  }
+  assert(walked == "ababababab");
+
+  // pool backed strings
+  CStringPool pool;
+  {
+    CPatchStr p("hello", pool);
+    p.append(CPatchStr(" world", pool));
+    assert(p.patchCount() == 1 && pool.blockCount() == 1);
+    p.insert(5, a);
+    assert(stringMatch(p.toStr(), "hellotesa world"));
+    pool.advanceEpoch();
+    CPatchStr q("!", pool);
+    q.insert(0, p.subStr(0, 5));
+    assert(pool.blockCount() == 2 && pool.reclaim() == 0);
+    p = q;
+    assert(q.compact(true) && pool.reclaim() == 0);
+    p.remove(0, 5);
+    assert(p.compact(true) && pool.reclaim() == CStringPool::BLOCK_SIZE);
+    assert(stringMatch(q.toStr(), "hello!") && stringMatch(p.toStr(), "!"));
+    try
+    {
+      CStringPool other;
+      q.append(CPatchStr("x", other));
+      assert("Exception not thrown" == nullptr);
+    }
+    catch (const std::invalid_argument &e)
+    {
+    }
+  }
+  pool.advanceEpoch();
+  assert(pool.reclaim() == CStringPool::BLOCK_SIZE && pool.blockCount() == 0);
+
+  // searching across patch boundaries
+  assert(d.find("datf") == 7 && d.find("datf", 8) == 11 && d.find("datfx") == CPatchStr::npos);
+  assert(d.rfind("at") == 12 && d.rfind("at", 11) == 8 && d.rfind("t a") == 0);
+  assert(d.count("at") == 4 && d.count("t") == 8);
+  const char *patterns[] = {"0", "12", "012", "3456", "0120", "89012345", "9", "777"};
+  for (const char *pattern : patterns)
+  {
+    std::string_view p = pattern;
+    assert(r.find(pattern) == model.find(p));
+    assert(r.find(pattern, 1000) == model.find(p, 1000));
+    assert(r.rfind(pattern) == model.rfind(p));
+    assert(r.rfind(pattern, 5000) == model.rfind(p, 5000));
+    size_t expected = 0;
+    for (size_t pos = model.find(p); pos != std::string::npos; pos = model.find(p, pos + p.size()))
+    {
+      ++expected;
+    }
+    assert(r.count(pattern) == expected);
+  }
+  CPatchStr g("aaaa bb aaa");
+  assert(g.replaceAll("aa", "c") == 3);
+  assert(stringMatch(g.toStr(), "cc bb ca"));
+  assert(g.replaceAll(" ", g) == 2);
+  assert(stringMatch(g.toStr(), "cccc bb cabbcc bb caca"));
+  assert(g.replaceAll("x", "y") == 0);
+
+  // batched edits with undo and redo
+  CPatchStr doc("hello big world");
+  CPatchStr::CBatch batch(doc);
+  batch.insert(15, "!").remove(6, 4).insert(0, "> ").insert(5, ",").remove(5, 3).insert(7, "x").insert(15, "?");
+  batch.commit();
+  assert(stringMatch(doc.toStr(), "> hello,xworld!?"));
+  batch.undo();
+  assert(stringMatch(doc.toStr(), "hello big world"));
+  batch.redo();
+  assert(stringMatch(doc.toStr(), "> hello,xworld!?"));
+  doc.append(".");
+  try
+  {
+    batch.undo();
+    assert("Exception not thrown" == nullptr);
+  }
+  catch (const std::logic_error &e)
+  {
+  }
+  CPatchStr::CBatch bad(doc);
+  try
+  {
+    bad.remove(10, 100).commit();
+    assert("Exception not thrown" == nullptr);
+  }
+  catch (const std::out_of_range &e)
+  {
+  }
+  assert(stringMatch(doc.toStr(), "> hello,xworld!?."));
   return EXIT_SUCCESS;
 }
 #endif /* __PROGTEST__ */
@@ -20,6 +20,11 @@
 #include <functional>
 #include <iterator>
 #include <compare>
+#include <optional>
+#include <cstdint>
+#include <sstream>
+#include <thread>
+#include <future>
 
 class CDate
 {
@@ -101,12 +106,12 @@ public:
     return m_names_set.contains(name);
   }
 
-  std::string getName() const
+  const std::string &getName() const
   {
     return m_name;
   }
 
-  CDate getDOB() const
+  const CDate &getDOB() const
   {
     return m_dob;
   }
@@ -246,6 +251,37 @@ public:
   {
     return m_empty;
   }
+
+  bool hasNameFilter() const
+  {
+    return m_filter_list[0];
+  }
+
+  const std::set<std::vector<std::string>> &getAcceptedNames() const
+  {
+    return m_accepted_names;
+  }
+
+  // exclusive bounds, empty when not filtered on
+  std::optional<CDate> getBornBefore() const
+  {
+    return m_filter_list[1] ? std::optional<CDate>(m_bornBefore) : std::nullopt;
+  }
+
+  std::optional<CDate> getBornAfter() const
+  {
+    return m_filter_list[2] ? std::optional<CDate>(m_bornAfter) : std::nullopt;
+  }
+
+  std::optional<int> getEnrolledBefore() const
+  {
+    return m_filter_list[3] ? std::optional<int>(m_enrolledBefore) : std::nullopt;
+  }
+
+  std::optional<int> getEnrolledAfter() const
+  {
+    return m_filter_list[4] ? std::optional<int>(m_enrolledAfter) : std::nullopt;
+  }
 };
 
 class CSort
@@ -335,8 +371,51 @@ public:
 class CStudyDept
 {
 private:
-  std::map<CStudent, std::list<CStudent>::iterator> m_db;
-  std::list<CStudent> m_db_list;
+  // students live in columns indexed by a dense slot, slots are handed out in registration order
+  // deleted slots stay behind until there are more of them than live ones, then compact() drops them
+  using TSlot = uint32_t;
+
+  static constexpr size_t COMPACT_MIN_DEAD = 1024;
+  // full scans over at least this many slots run in parallel
+  static constexpr size_t PARALLEL_MIN_SLOTS = 1 << 16;
+  // smaller pages stream serially and stop early instead
+  static constexpr size_t PARALLEL_MIN_ROWS = 256;
+
+  // interned full names with their sorted token ids (duplicates kept, the name filter compares them as a multiset)
+  std::vector<std::string> m_names;
+  std::unordered_map<std::string, uint32_t> m_name_ids;
+  std::vector<std::vector<uint32_t>> m_name_tokens;
+
+  // interned lower-cased name tokens and the sorted slots of the students having each
+  std::vector<std::string> m_tokens;
+  std::unordered_map<std::string, uint32_t> m_token_ids;
+  std::vector<std::vector<TSlot>> m_postings;
+  // names containing each token, sorted by name id
+  std::vector<std::vector<uint32_t>> m_token_names;
+  // token ids in the lexicographic order of the tokens, a prefix matches a contiguous range
+  std::vector<uint32_t> m_token_order;
+  // live students per name id
+  std::vector<size_t> m_name_count;
+
+  // columns
+  std::vector<uint32_t> m_name_col;
+  std::vector<CDate> m_dob_col;
+  std::vector<int> m_year_col;
+  // registration number, survives compaction so it orders students and breaks sort ties
+  std::vector<size_t> m_seq_col;
+  std::vector<bool> m_alive;
+  size_t m_live = 0;
+  size_t m_next_seq = 0;
+
+  size_t m_workers = std::max(1u, std::thread::hardware_concurrency());
+  size_t m_parallel_min = PARALLEL_MIN_SLOTS;
+
+  // (name id, enrollment year) -> slots, finds duplicates and students to delete
+  std::unordered_map<uint64_t, std::vector<TSlot>> m_lookup;
+
+  // birth date / enrollment year -> sorted slots
+  std::map<CDate, std::vector<TSlot>> m_dob_index;
+  std::map<int, std::vector<TSlot>> m_year_index;
 
   void splitNameIntoWords(const std::string &full_name, std::vector<std::string> &vec) const
   {
@@ -362,49 +441,898 @@ private:
     }
   }
 
+  static uint64_t lookupKey(uint32_t nameId, int year)
+  {
+    return (uint64_t(nameId) << 32) | uint32_t(year);
+  }
+
+  uint32_t internName(const std::string &name)
+  {
+    auto [it, inserted] = m_name_ids.emplace(name, m_names.size());
+    if (inserted)
+    {
+      std::vector<std::string> words;
+      splitNameIntoWords(name, words);
+      std::vector<uint32_t> tokens;
+      for (const auto &word : words)
+      {
+        auto [token, added] = m_token_ids.emplace(word, m_tokens.size());
+        if (added)
+        {
+          m_tokens.push_back(word);
+          m_postings.emplace_back();
+          m_token_names.emplace_back();
+          auto pos = std::lower_bound(m_token_order.begin(), m_token_order.end(), word, [this](uint32_t id, const std::string &w)
+                                      { return m_tokens[id] < w; });
+          m_token_order.insert(pos, token->second);
+        }
+        auto &names = m_token_names[token->second];
+        if (names.empty() || names.back() != m_names.size())
+        {
+          names.push_back(m_names.size());
+        }
+        tokens.push_back(token->second);
+      }
+      std::sort(tokens.begin(), tokens.end());
+      m_names.push_back(name);
+      m_name_tokens.push_back(std::move(tokens));
+      m_name_count.push_back(0);
+    }
+    return it->second;
+  }
+
+  static std::vector<uint32_t> uniqueTokens(std::vector<uint32_t> tokens)
+  {
+    std::sort(tokens.begin(), tokens.end());
+    tokens.erase(std::unique(tokens.begin(), tokens.end()), tokens.end());
+    return tokens;
+  }
+
+  // slot of the student equal to x, SIZE_MAX when not registered
+  size_t findSlot(const CStudent &x) const
+  {
+    auto name = m_name_ids.find(x.getName());
+    if (name == m_name_ids.end())
+    {
+      return SIZE_MAX;
+    }
+    auto slots = m_lookup.find(lookupKey(name->second, x.getEnrollment()));
+    if (slots != m_lookup.end())
+    {
+      for (TSlot slot : slots->second)
+      {
+        if (m_dob_col[slot] == x.getDOB())
+        {
+          return slot;
+        }
+      }
+    }
+    return SIZE_MAX;
+  }
+
+  // walks small and gallops through large to find each slot
+  static std::vector<TSlot> intersectPostings(const std::vector<TSlot> &small, const std::vector<TSlot> &large)
+  {
+    std::vector<TSlot> result;
+    size_t lo = 0;
+    for (TSlot slot : small)
+    {
+      size_t step = 1;
+      while (lo + step < large.size() && large[lo + step] < slot)
+      {
+        step *= 2;
+      }
+      lo = std::lower_bound(large.begin() + lo + step / 2, large.begin() + std::min(lo + step + 1, large.size()), slot) - large.begin();
+      if (lo == large.size())
+      {
+        break;
+      }
+      if (large[lo] == slot)
+      {
+        result.push_back(slot);
+        ++lo;
+      }
+    }
+    return result;
+  }
+
+  // sorted slots of the students whose name contains every token, starting from the shortest posting list
+  std::vector<TSlot> studentsWithTokens(const std::vector<uint32_t> &tokens) const
+  {
+    std::vector<const std::vector<TSlot> *> lists;
+    for (uint32_t token : uniqueTokens(tokens))
+    {
+      lists.push_back(&m_postings[token]);
+    }
+
+    std::sort(lists.begin(), lists.end(), [](const auto *a, const auto *b)
+              { return a->size() < b->size(); });
+    std::vector<TSlot> result = *lists[0];
+    for (size_t i = 1; i < lists.size() && !result.empty(); ++i)
+    {
+      result = intersectPostings(result, *lists[i]);
+    }
+    return result;
+  }
+
+  template <typename TKey>
+  static void removeFromIndex(std::map<TKey, std::vector<TSlot>> &index, const TKey &key, TSlot slot)
+  {
+    auto it = index.find(key);
+    auto &slots = it->second;
+    slots.erase(std::lower_bound(slots.begin(), slots.end(), slot));
+    if (slots.empty())
+    {
+      index.erase(it);
+    }
+  }
+
+  // keys strictly between after and before
+  template <typename TKey>
+  static auto indexRange(const std::map<TKey, std::vector<TSlot>> &index, const std::optional<TKey> &after, const std::optional<TKey> &before)
+  {
+    if (after && before && !(*after < *before))
+    {
+      return std::make_pair(index.end(), index.end());
+    }
+    return std::make_pair(after ? index.upper_bound(*after) : index.begin(), before ? index.lower_bound(*before) : index.end());
+  }
+
+  // students in the range, counting stops once limit is reached
+  template <typename TKey>
+  static size_t rangeSize(const std::map<TKey, std::vector<TSlot>> &index, const std::optional<TKey> &after, const std::optional<TKey> &before, size_t limit)
+  {
+    auto [it, end] = indexRange(index, after, before);
+    size_t total = 0;
+    for (; it != end && total < limit; ++it)
+    {
+      total += it->second.size();
+    }
+    return total;
+  }
+
+  template <typename TKey>
+  static std::vector<TSlot> rangeSlots(const std::map<TKey, std::vector<TSlot>> &index, const std::optional<TKey> &after, const std::optional<TKey> &before)
+  {
+    auto [it, end] = indexRange(index, after, before);
+    std::vector<TSlot> slots;
+    for (; it != end; ++it)
+    {
+      slots.insert(slots.end(), it->second.begin(), it->second.end());
+    }
+    std::sort(slots.begin(), slots.end());
+    return slots;
+  }
+
+  // tokens starting with prefix, a binary searched range of m_token_order
+  std::pair<size_t, size_t> prefixRange(const std::string &prefix, size_t from = 0) const
+  {
+    auto begin = std::lower_bound(m_token_order.begin() + from, m_token_order.end(), prefix, [this](uint32_t id, const std::string &p)
+                                  { return m_tokens[id] < p; });
+    auto end = std::partition_point(begin, m_token_order.end(), [this, &prefix](uint32_t id)
+                                    { return m_tokens[id].compare(0, prefix.size(), prefix) == 0; });
+    return {begin - m_token_order.begin(), end - m_token_order.begin()};
+  }
+
+  // tokens with a prefix within maxEdits edits of word, with the fewest edits needed;
+  // walks the sorted tokens like a trie, one edit distance column per token character,
+  // columns of a shared prefix are reused and a subtree is settled at once when no cell is within the bound
+  std::vector<std::pair<uint32_t, size_t>> matchTokens(const std::string &word, size_t maxEdits) const
+  {
+    std::vector<std::pair<uint32_t, size_t>> result;
+    if (maxEdits == 0)
+    {
+      auto [begin, end] = prefixRange(word);
+      for (size_t i = begin; i < end; ++i)
+      {
+        result.emplace_back(m_token_order[i], 0);
+      }
+      return result;
+    }
+
+    size_t m = word.size();
+    // columns[j][i] = edits between word[0, i) and the first j characters of the token, best[j] = min over columns[0..j][m]
+    std::vector<std::vector<size_t>> columns(1, std::vector<size_t>(m + 1));
+    for (size_t i = 0; i <= m; ++i)
+    {
+      columns[0][i] = i;
+    }
+    std::vector<size_t> best(1, m);
+    std::string prev;
+
+    for (size_t pos = 0; pos < m_token_order.size();)
+    {
+      const std::string &token = m_tokens[m_token_order[pos]];
+      size_t shared = 0;
+      while (shared < prev.size() && shared < token.size() && prev[shared] == token[shared])
+      {
+        ++shared;
+      }
+      columns.resize(shared + 1);
+      best.resize(shared + 1);
+
+      bool pruned = false;
+      for (size_t j = shared + 1; j <= token.size(); ++j)
+      {
+        const auto &last = columns.back();
+        std::vector<size_t> column(m + 1);
+        column[0] = j;
+        size_t lowest = column[0];
+        for (size_t i = 1; i <= m; ++i)
+        {
+          column[i] = std::min({last[i] + 1, column[i - 1] + 1, last[i - 1] + (word[i - 1] != token[j - 1])});
+          lowest = std::min(lowest, column[i]);
+        }
+        if (lowest > maxEdits)
+        {
+          // deeper columns stay over the bound, every token below this prefix ends with the distance reached so far
+          size_t end = prefixRange(token.substr(0, j), pos).second;
+          for (; best.back() <= maxEdits && pos < end; ++pos)
+          {
+            result.emplace_back(m_token_order[pos], best.back());
+          }
+          pos = end;
+          prev = token.substr(0, j - 1);
+          pruned = true;
+          break;
+        }
+        best.push_back(std::min(best.back(), column[m]));
+        columns.push_back(std::move(column));
+      }
+      if (pruned)
+      {
+        continue;
+      }
+      if (best.back() <= maxEdits)
+      {
+        result.emplace_back(m_token_order[pos], best.back());
+      }
+      prev = token;
+      ++pos;
+    }
+    return result;
+  }
+
+  // drops deleted slots and renumbers the rest in the same order
+  void compact()
+  {
+    std::vector<TSlot> remap(m_alive.size());
+    size_t next = 0;
+    for (size_t slot = 0; slot < m_alive.size(); ++slot)
+    {
+      if (m_alive[slot])
+      {
+        remap[slot] = next;
+        m_name_col[next] = m_name_col[slot];
+        m_dob_col[next] = m_dob_col[slot];
+        m_year_col[next] = m_year_col[slot];
+        m_seq_col[next] = m_seq_col[slot];
+        ++next;
+      }
+    }
+    m_name_col.resize(next);
+    m_dob_col.erase(m_dob_col.begin() + next, m_dob_col.end());
+    m_year_col.resize(next);
+    m_seq_col.resize(next);
+    m_alive.assign(next, true);
+
+    auto renumber = [&remap](std::vector<TSlot> &slots)
+    {
+      for (TSlot &slot : slots)
+      {
+        slot = remap[slot];
+      }
+    };
+    for (auto &slots : m_postings)
+    {
+      renumber(slots);
+    }
+    for (auto &[key, slots] : m_lookup)
+    {
+      renumber(slots);
+    }
+    for (auto &[key, slots] : m_dob_index)
+    {
+      renumber(slots);
+    }
+    for (auto &[key, slots] : m_year_index)
+    {
+      renumber(slots);
+    }
+  }
+
+  // a filter translated to interned tokens, evaluated straight on the columns
+  struct SQuery
+  {
+    bool m_by_name = false;
+    // accepted names as sorted token ids, names with an unknown token can't match and are left out
+    std::vector<std::vector<uint32_t>> m_names;
+    std::optional<CDate> m_born_after, m_born_before;
+    std::optional<int> m_enrolled_after, m_enrolled_before;
+  };
+
+  SQuery compile(const CFilter &flt) const
+  {
+    SQuery query;
+    query.m_born_after = flt.getBornAfter();
+    query.m_born_before = flt.getBornBefore();
+    query.m_enrolled_after = flt.getEnrolledAfter();
+    query.m_enrolled_before = flt.getEnrolledBefore();
+    query.m_by_name = flt.hasNameFilter() && !flt.getAcceptedNames().empty();
+
+    for (const auto &words : flt.getAcceptedNames())
+    {
+      std::vector<uint32_t> tokens;
+      for (const auto &word : words)
+      {
+        auto it = m_token_ids.find(word);
+        if (it == m_token_ids.end())
+        {
+          break;
+        }
+        tokens.push_back(it->second);
+      }
+      if (tokens.size() == words.size())
+      {
+        std::sort(tokens.begin(), tokens.end());
+        query.m_names.push_back(std::move(tokens));
+      }
+    }
+    return query;
+  }
+
+  bool passes(const SQuery &query, TSlot slot) const
+  {
+    if (query.m_born_before && !(m_dob_col[slot] < *query.m_born_before))
+    {
+      return false;
+    }
+    if (query.m_born_after && !(*query.m_born_after < m_dob_col[slot]))
+    {
+      return false;
+    }
+    if (query.m_enrolled_before && m_year_col[slot] >= *query.m_enrolled_before)
+    {
+      return false;
+    }
+    if (query.m_enrolled_after && m_year_col[slot] <= *query.m_enrolled_after)
+    {
+      return false;
+    }
+    if (query.m_by_name)
+    {
+      const auto &tokens = m_name_tokens[m_name_col[slot]];
+      return std::find(query.m_names.begin(), query.m_names.end(), tokens) != query.m_names.end();
+    }
+    return true;
+  }
+
+  enum class EPlan
+  {
+    SCAN,
+    NAME,
+    BIRTH_DATE,
+    ENROLL_YEAR
+  };
+
+  bool nameIndexUsable(const SQuery &query) const
+  {
+    return query.m_by_name && std::none_of(query.m_names.begin(), query.m_names.end(), [](const auto &tokens)
+                                           { return tokens.empty(); });
+  }
+
+  // picks the predicate with the smallest estimated result, SCAN when no index beats a full scan
+  EPlan choosePlan(const SQuery &query) const
+  {
+    EPlan plan = EPlan::SCAN;
+    size_t best = m_live;
+
+    if (nameIndexUsable(query))
+    {
+      // upper bound, the shortest posting list of each accepted name
+      size_t estimate = 0;
+      for (const auto &tokens : query.m_names)
+      {
+        size_t smallest = SIZE_MAX;
+        for (uint32_t token : tokens)
+        {
+          smallest = std::min(smallest, m_postings[token].size());
+        }
+        estimate += smallest;
+      }
+      if (estimate < best)
+      {
+        plan = EPlan::NAME;
+        best = estimate;
+      }
+    }
+    if (query.m_born_after || query.m_born_before)
+    {
+      size_t estimate = rangeSize(m_dob_index, query.m_born_after, query.m_born_before, best);
+      if (estimate < best)
+      {
+        plan = EPlan::BIRTH_DATE;
+        best = estimate;
+      }
+    }
+    if (query.m_enrolled_after || query.m_enrolled_before)
+    {
+      size_t estimate = rangeSize(m_year_index, query.m_enrolled_after, query.m_enrolled_before, best);
+      if (estimate < best)
+      {
+        plan = EPlan::ENROLL_YEAR;
+        best = estimate;
+      }
+    }
+    return plan;
+  }
+
+  // calls visit(slot) for every live student that may pass the query in registration order, the caller checks the query
+  template <typename TVisit>
+  void forEachCandidate(const SQuery &query, EPlan plan, TVisit &&visit) const
+  {
+    std::vector<TSlot> slots;
+    switch (plan)
+    {
+    case EPlan::SCAN:
+      for (size_t slot = 0; slot < m_alive.size(); ++slot)
+      {
+        if (m_alive[slot])
+        {
+          visit(slot);
+        }
+      }
+      return;
+    case EPlan::NAME:
+      for (const auto &tokens : query.m_names)
+      {
+        std::vector<TSlot> match = studentsWithTokens(tokens);
+        slots.insert(slots.end(), match.begin(), match.end());
+      }
+      std::sort(slots.begin(), slots.end());
+      slots.erase(std::unique(slots.begin(), slots.end()), slots.end());
+      break;
+    case EPlan::BIRTH_DATE:
+      slots = rangeSlots(m_dob_index, query.m_born_after, query.m_born_before);
+      break;
+    case EPlan::ENROLL_YEAR:
+      slots = rangeSlots(m_year_index, query.m_enrolled_after, query.m_enrolled_before);
+      break;
+    }
+    for (TSlot slot : slots)
+    {
+      visit(slot);
+    }
+  }
+
+  // sort keys of one result, taken once so comparisons copy nothing
+  struct SSortRow
+  {
+    TSlot m_slot;
+    const std::string *m_name;
+    CDate m_dob;
+    int m_year;
+    // registration number
+    size_t m_id;
+  };
+
+  SSortRow makeRow(TSlot slot) const
+  {
+    return SSortRow{slot, &m_names[m_name_col[slot]], m_dob_col[slot], m_year_col[slot], m_seq_col[slot]};
+  }
+
+  // registration order breaks ties, so the order is total and needs no stable sort
+  static bool rowLess(const SSortRow &lhs, const SSortRow &rhs, const std::vector<std::pair<ESortKey, bool>> &keys)
+  {
+    for (const auto &[key, ascending] : keys)
+    {
+      std::strong_ordering cmp = std::strong_ordering::equal;
+      switch (key)
+      {
+      case ESortKey::NAME:
+        cmp = lhs.m_name->compare(*rhs.m_name) <=> 0;
+        break;
+      case ESortKey::BIRTH_DATE:
+        cmp = lhs.m_dob <=> rhs.m_dob;
+        break;
+      case ESortKey::ENROLL_YEAR:
+        cmp = lhs.m_year <=> rhs.m_year;
+        break;
+      }
+      if (cmp != 0)
+      {
+        return ascending ? cmp < 0 : cmp > 0;
+      }
+    }
+    return lhs.m_id < rhs.m_id;
+  }
+
+  // sorts rows and keeps the first limit, a partial sort when only a few are wanted
+  static void sortRows(std::vector<SSortRow> &rows, const std::vector<std::pair<ESortKey, bool>> &keys, size_t limit)
+  {
+    auto less = [&keys](const SSortRow &lhs, const SSortRow &rhs)
+    { return rowLess(lhs, rhs, keys); };
+    if (limit < rows.size())
+    {
+      std::partial_sort(rows.begin(), rows.begin() + limit, rows.end(), less);
+      rows.erase(rows.begin() + limit, rows.end());
+    }
+    else
+    {
+      std::sort(rows.begin(), rows.end(), less);
+    }
+  }
+
+  // walks the index in the order of the leading sort key from the key of after on, only students sharing one key value are sorted together
+  template <typename TKey>
+  void streamByIndex(const std::map<TKey, std::vector<TSlot>> &index, const std::optional<TKey> &lower, const std::optional<TKey> &upper,
+                     const std::optional<TKey> &from, const SQuery &query, const std::vector<std::pair<ESortKey, bool>> &keys,
+                     size_t limit, const SSortRow *after, std::vector<SSortRow> &out) const
+  {
+    auto [begin, end] = indexRange(index, lower, upper);
+    // a strictly before b, end of the map counts as past every key
+    auto precedes = [&index](auto a, auto b)
+    { return a != index.end() && (b == index.end() || a->first < b->first); };
+    bool ascending = keys[0].second;
+    if (from && ascending)
+    {
+      auto it = index.lower_bound(*from);
+      begin = precedes(begin, it) ? it : begin;
+    }
+    else if (from)
+    {
+      auto it = index.upper_bound(*from);
+      end = precedes(it, end) ? it : end;
+    }
+    if (precedes(end, begin))
+    {
+      begin = end;
+    }
+
+    std::vector<SSortRow> rows;
+    auto emit = [&](const std::vector<TSlot> &slots)
+    {
+      rows.clear();
+      for (TSlot slot : slots)
+      {
+        if (passes(query, slot))
+        {
+          SSortRow row = makeRow(slot);
+          if (!after || rowLess(*after, row, keys))
+          {
+            rows.push_back(row);
+          }
+        }
+      }
+      sortRows(rows, keys, limit - out.size());
+      out.insert(out.end(), rows.begin(), rows.end());
+    };
+
+    if (ascending)
+    {
+      for (auto it = begin; it != end && out.size() < limit; ++it)
+      {
+        emit(it->second);
+      }
+    }
+    else
+    {
+      for (auto it = std::make_reverse_iterator(end); it != std::make_reverse_iterator(begin) && out.size() < limit; ++it)
+      {
+        emit(it->second);
+      }
+    }
+  }
+
+  // merges two sorted runs, keeping at most limit rows
+  static std::vector<SSortRow> mergeRuns(const std::vector<SSortRow> &a, const std::vector<SSortRow> &b,
+                                         const std::vector<std::pair<ESortKey, bool>> &keys, size_t limit)
+  {
+    std::vector<SSortRow> out;
+    out.reserve(std::min(a.size() + b.size(), limit));
+    size_t i = 0, j = 0;
+    while (out.size() < limit && (i < a.size() || j < b.size()))
+    {
+      out.push_back(j == b.size() || (i < a.size() && !rowLess(b[j], a[i], keys)) ? a[i++] : b[j++]);
+    }
+    return out;
+  }
+
+  // splits the slots between the workers, each filters and sorts its part into a local vector,
+  // the sorted parts are then merged pairwise, the merges of one round running in parallel too
+  std::vector<SSortRow> parallelScan(const SQuery &query, const std::vector<std::pair<ESortKey, bool>> &keys, size_t limit, const SSortRow *after) const
+  {
+    size_t slots = m_alive.size();
+    std::vector<std::future<std::vector<SSortRow>>> tasks;
+    for (size_t part = 0; part < m_workers; ++part)
+    {
+      size_t lo = slots * part / m_workers, hi = slots * (part + 1) / m_workers;
+      tasks.push_back(std::async(std::launch::async, [this, &query, &keys, limit, after, lo, hi]()
+                                 {
+                                   std::vector<SSortRow> rows;
+                                   for (size_t slot = lo; slot < hi; ++slot)
+                                   {
+                                     if (m_alive[slot] && passes(query, slot))
+                                     {
+                                       SSortRow row = makeRow(slot);
+                                       if (!after || rowLess(*after, row, keys))
+                                       {
+                                         rows.push_back(row);
+                                       }
+                                     }
+                                   }
+                                   sortRows(rows, keys, limit);
+                                   return rows; }));
+    }
+
+    std::vector<std::vector<SSortRow>> runs;
+    for (auto &task : tasks)
+    {
+      runs.push_back(task.get());
+    }
+    while (runs.size() > 1)
+    {
+      std::vector<std::future<std::vector<SSortRow>>> merges;
+      for (size_t i = 0; i + 1 < runs.size(); i += 2)
+      {
+        merges.push_back(std::async(std::launch::async, [&runs, &keys, limit, i]()
+                                    { return mergeRuns(runs[i], runs[i + 1], keys, limit); }));
+      }
+      std::vector<std::vector<SSortRow>> merged;
+      for (auto &merge : merges)
+      {
+        merged.push_back(merge.get());
+      }
+      if (runs.size() % 2)
+      {
+        merged.push_back(std::move(runs.back()));
+      }
+      runs = std::move(merged);
+    }
+    return std::move(runs[0]);
+  }
+
+  // the first limit rows of the sorted result that come after the row after (from the start without it)
+  std::vector<SSortRow> page(const CFilter &flt, const std::vector<std::pair<ESortKey, bool>> &keys, size_t limit, const SSortRow *after) const
+  {
+    std::vector<SSortRow> rows;
+    if (limit == 0)
+    {
+      return rows;
+    }
+
+    SQuery query = compile(flt);
+    EPlan plan = choosePlan(query);
+
+    if (plan == EPlan::SCAN && m_workers > 1 && m_alive.size() >= m_parallel_min && limit >= PARALLEL_MIN_ROWS)
+    {
+      return parallelScan(query, keys, limit, after);
+    }
+    // stream straight from the index of the leading key unless another index narrows the search more
+    if (keys.empty() && plan == EPlan::SCAN)
+    {
+      size_t first = after ? std::upper_bound(m_seq_col.begin(), m_seq_col.end(), after->m_id) - m_seq_col.begin() : 0;
+      for (size_t slot = first; slot < m_alive.size() && rows.size() < limit; ++slot)
+      {
+        if (m_alive[slot] && passes(query, slot))
+        {
+          rows.push_back(makeRow(slot));
+        }
+      }
+      return rows;
+    }
+    if (!keys.empty() && keys[0].first == ESortKey::BIRTH_DATE && (plan == EPlan::SCAN || plan == EPlan::BIRTH_DATE))
+    {
+      streamByIndex(m_dob_index, query.m_born_after, query.m_born_before, after ? std::optional<CDate>(after->m_dob) : std::nullopt,
+                    query, keys, limit, after, rows);
+      return rows;
+    }
+    if (!keys.empty() && keys[0].first == ESortKey::ENROLL_YEAR && (plan == EPlan::SCAN || plan == EPlan::ENROLL_YEAR))
+    {
+      streamByIndex(m_year_index, query.m_enrolled_after, query.m_enrolled_before, after ? std::optional<int>(after->m_year) : std::nullopt,
+                    query, keys, limit, after, rows);
+      return rows;
+    }
+
+    forEachCandidate(query, plan, [&](TSlot slot)
+                     {
+                       if (passes(query, slot))
+                       {
+                         SSortRow row = makeRow(slot);
+                         if (!after || rowLess(*after, row, keys))
+                         {
+                           rows.push_back(row);
+                         }
+                       } });
+    sortRows(rows, keys, limit);
+    return rows;
+  }
+
+  std::list<CStudent> toStudents(const std::vector<SSortRow> &rows) const
+  {
+    std::list<CStudent> result;
+    for (const auto &row : rows)
+    {
+      result.emplace_back(*row.m_name, row.m_dob, row.m_year);
+    }
+    return result;
+  }
+
+  // the full sort tuple of a row, enough to find the position again after the student is gone
+  static std::string encodeRow(const SSortRow &row)
+  {
+    std::ostringstream os;
+    os << row.m_id << ' ' << row.m_year << ' ' << row.m_dob << ' ' << *row.m_name;
+    return os.str();
+  }
+
+  // name receives the name the decoded row points to
+  static SSortRow decodeRow(const std::string &key, std::string &name)
+  {
+    std::istringstream is(key);
+    size_t id;
+    int year, y, m, d;
+    char dash1, dash2;
+    if (!(is >> id >> year >> y >> dash1 >> m >> dash2 >> d) || dash1 != '-' || dash2 != '-' || is.get() != ' ')
+    {
+      throw std::invalid_argument("Invalid continuation key.");
+    }
+    std::getline(is, name);
+    return SSortRow{0, &name, CDate(y, m, d), year, id};
+  }
+
 public:
   CStudyDept() {}
 
+  // number of threads for unselective searches (1 keeps them serial) and the store size from which they are used
+  void setScanWorkers(size_t workers, size_t minSlots = PARALLEL_MIN_SLOTS)
+  {
+    m_workers = std::max<size_t>(1, workers);
+    m_parallel_min = minSlots;
+  }
+
   bool addStudent(const CStudent &x)
   {
-    auto [it, inserted] = m_db.insert({x, m_db_list.end()});
+    if (findSlot(x) != SIZE_MAX)
+    {
+      return false;
+    }
 
-    if (inserted)
+    uint32_t nameId = internName(x.getName());
+    TSlot slot = m_name_col.size();
+    m_name_col.push_back(nameId);
+    m_dob_col.push_back(x.getDOB());
+    m_year_col.push_back(x.getEnrollment());
+    m_seq_col.push_back(m_next_seq++);
+    m_alive.push_back(true);
+    ++m_live;
+
+    ++m_name_count[nameId];
+    m_lookup[lookupKey(nameId, x.getEnrollment())].push_back(slot);
+    for (uint32_t token : uniqueTokens(m_name_tokens[nameId]))
     {
-      m_db_list.push_back(x);
-      it->second = std::prev(m_db_list.end());
-      return true;
+      m_postings[token].push_back(slot);
     }
-    return false;
+    m_dob_index[x.getDOB()].push_back(slot);
+    m_year_index[x.getEnrollment()].push_back(slot);
+    return true;
   }
 
   bool delStudent(const CStudent &x)
   {
-    // Find and erase the student from the main database
-    auto it = m_db.find(x);
-    if (it != m_db.end())
+    size_t found = findSlot(x);
+    if (found == SIZE_MAX)
     {
-      m_db_list.erase(it->second);
-      m_db.erase(it);
-      return true;
+      return false;
     }
-    return false;
+
+    TSlot slot = found;
+    uint32_t nameId = m_name_col[slot];
+    --m_name_count[nameId];
+    auto lookup = m_lookup.find(lookupKey(nameId, x.getEnrollment()));
+    lookup->second.erase(std::find(lookup->second.begin(), lookup->second.end(), slot));
+    if (lookup->second.empty())
+    {
+      m_lookup.erase(lookup);
+    }
+    for (uint32_t token : uniqueTokens(m_name_tokens[nameId]))
+    {
+      auto &slots = m_postings[token];
+      slots.erase(std::lower_bound(slots.begin(), slots.end(), slot));
+    }
+    removeFromIndex(m_dob_index, x.getDOB(), slot);
+    removeFromIndex(m_year_index, x.getEnrollment(), slot);
+    m_alive[slot] = false;
+    --m_live;
+
+    size_t dead = m_alive.size() - m_live;
+    if (dead >= COMPACT_MIN_DEAD && dead > m_live)
+    {
+      compact();
+    }
+    return true;
   }
 
   std::list<CStudent> search(const CFilter &flt, const CSort &sortOpt) const
   {
-    std::list<CStudent> result;
+    return search(flt, sortOpt, SIZE_MAX);
+  }
+
+  // the first limit students of the full sorted result
+  std::list<CStudent> search(const CFilter &flt, const CSort &sortOpt, size_t limit) const
+  {
+    return toStudents(page(flt, sortOpt.getKeyList(), limit, nullptr));
+  }
 
-    for (const auto &student : m_db_list)
+  // hands out a search result page by page, each page costs about as much as its rows plus a lookup
+  // continuation() can be stored and passed to searchCursor later to go on, also after students were added or removed
+  class CCursor
+  {
+  public:
+    std::list<CStudent> next()
     {
-      if (flt.isEmpty() || flt.passesFilter(student))
+      std::list<CStudent> result;
+      if (m_done)
       {
-        result.push_back(student);
+        return result;
       }
+
+      std::string name;
+      std::vector<SSortRow> rows;
+      if (m_continuation.empty())
+      {
+        rows = m_dept->page(m_filter, m_keys, m_page_size, nullptr);
+      }
+      else
+      {
+        SSortRow after = decodeRow(m_continuation, name);
+        rows = m_dept->page(m_filter, m_keys, m_page_size, &after);
+      }
+
+      result = m_dept->toStudents(rows);
+      if (!rows.empty())
+      {
+        m_continuation = encodeRow(rows.back());
+      }
+      m_done = rows.size() < m_page_size;
+      return result;
     }
 
-    result.sort(CStudentDeptComparator(sortOpt));
-    return result;
+    bool done() const
+    {
+      return m_done;
+    }
+
+    const std::string &continuation() const
+    {
+      return m_continuation;
+    }
+
+  private:
+    friend class CStudyDept;
+
+    const CStudyDept *m_dept;
+    CFilter m_filter;
+    std::vector<std::pair<ESortKey, bool>> m_keys;
+    size_t m_page_size;
+    // opaque position after the last returned student, empty before the first page
+    std::string m_continuation;
+    bool m_done;
+
+    CCursor(const CStudyDept &dept, const CFilter &flt, const CSort &sortOpt, size_t pageSize, const std::string &continuation)
+        : m_dept(&dept), m_filter(flt), m_keys(sortOpt.getKeyList()), m_page_size(pageSize), m_continuation(continuation), m_done(pageSize == 0)
+    {
+      if (!continuation.empty())
+      {
+        std::string name;
+        decodeRow(continuation, name);
+      }
+    }
+  };
+
+  CCursor searchCursor(const CFilter &flt, const CSort &sortOpt, size_t pageSize, const std::string &continuation = "") const
+  {
+    return CCursor(*this, flt, sortOpt, pageSize, continuation);
   }
 
   std::set<std::string> suggest(const std::string &name) const
@@ -420,21 +1348,96 @@ public:
       return res;
     }
 
-    for (const auto &student : m_db_list)
+    std::vector<uint32_t> tokens;
+    for (const auto &word : vec)
     {
-      bool pass = true;
-      for (const auto &name : vec)
+      auto it = m_token_ids.find(word);
+      if (it == m_token_ids.end())
       {
-        if (!student.passesNameFilter(name))
-          pass = false;
+        return res;
       }
+      tokens.push_back(it->second);
+    }
 
-      if (pass)
-        res.insert(student.getName());
+    for (TSlot slot : studentsWithTokens(tokens))
+    {
+      res.insert(m_names[m_name_col[slot]]);
     }
 
     return res;
   }
+
+  // autocomplete, every word of prefix has to start some word of the name, with up to maxEdits typos per word;
+  // at most k names, the fewest typos first, then the names most students share, then alphabetically
+  std::vector<std::string> suggest(const std::string &prefix, size_t k, size_t maxEdits = 0) const
+  {
+    std::vector<std::string> words;
+    splitNameIntoWords(prefix, words);
+    if (words.empty() || k == 0)
+    {
+      return {};
+    }
+
+    // name id -> total edits, narrowed word by word
+    std::unordered_map<uint32_t, size_t> candidates;
+    for (size_t w = 0; w < words.size(); ++w)
+    {
+      std::unordered_map<uint32_t, size_t> matched;
+      for (const auto &[token, edits] : matchTokens(words[w], maxEdits))
+      {
+        for (uint32_t nameId : m_token_names[token])
+        {
+          if (m_name_count[nameId] == 0)
+          {
+            continue;
+          }
+          size_t total = edits;
+          if (w > 0)
+          {
+            auto it = candidates.find(nameId);
+            if (it == candidates.end())
+            {
+              continue;
+            }
+            total += it->second;
+          }
+          auto [it, inserted] = matched.emplace(nameId, total);
+          if (!inserted)
+          {
+            it->second = std::min(it->second, total);
+          }
+        }
+      }
+      candidates = std::move(matched);
+      if (candidates.empty())
+      {
+        return {};
+      }
+    }
+
+    std::vector<std::pair<uint32_t, size_t>> ranked(candidates.begin(), candidates.end());
+    auto better = [this](const auto &lhs, const auto &rhs)
+    {
+      if (lhs.second != rhs.second)
+      {
+        return lhs.second < rhs.second;
+      }
+      if (m_name_count[lhs.first] != m_name_count[rhs.first])
+      {
+        return m_name_count[lhs.first] > m_name_count[rhs.first];
+      }
+      return m_names[lhs.first] < m_names[rhs.first];
+    };
+    k = std::min(k, ranked.size());
+    std::partial_sort(ranked.begin(), ranked.begin() + k, ranked.end(), better);
+
+    std::vector<std::string> result;
+    for (size_t i = 0; i < k; ++i)
+    {
+      result.push_back(m_names[ranked[i].first]);
+    }
+    return result;
+  }
 };
 
 #ifndef __PROGTEST__
@@ -541,6 +1544,14 @@ int main(void)
                                          "Peter John Taylor"}));
   assert(x0.suggest("peter joHn bond") == (std::set<std::string>{}));
   assert(x0.suggest("pete") == (std::set<std::string>{}));
+  assert(x0.suggest("pete", 10) == (std::vector<std::string>{"John Peter Taylor", "Peter John Taylor", "Peter Taylor"}));
+  assert(x0.suggest("j bo", 1) == (std::vector<std::string>{"James Bond"}));
+  assert(x0.suggest("j bo", 5) == (std::vector<std::string>{"James Bond", "Bond James"}));
+  assert(x0.suggest("jmes", 5).empty());
+  assert(x0.suggest("jmes", 5, 1) == (std::vector<std::string>{"James Bond", "Bond James"}));
+  assert(x0.suggest("tailor pter", 5, 1) == (std::vector<std::string>{"John Peter Taylor", "Peter John Taylor", "Peter Taylor"}));
+  assert(x0.suggest("bind", 5, 1) == (std::vector<std::string>{"James Bond", "Bond James"}));
+  assert(x0.suggest("  ", 5).empty() && x0.suggest("james", 0).empty());
   assert(x0.suggest("peter joHn PETER") == (std::set<std::string>{
                                                "John Peter Taylor",
                                                "Peter John Taylor"}));
@@ -555,6 +1566,107 @@ int main(void)
                                                                                                                                                                                                                                                         CStudent("James Bond", CDate(1981, 7, 16), 2012),
                                                                                                                                                                                                                                                         CStudent("John Taylor", CDate(1981, 6, 30), 2012)}));
   assert(!x0.delStudent(CStudent("James Bond", CDate(1981, 7, 16), 2013)));
+  assert(x0.delStudent(CStudent("Peter Taylor", CDate(1982, 2, 23), 2011)));
+  assert(x0.suggest("peter taylor") == (std::set<std::string>{
+                                           "John Peter Taylor",
+                                           "Peter John Taylor"}));
+  assert(x0.addStudent(CStudent("Peter Taylor", CDate(1982, 2, 23), 2011)));
+  assert(x0.search(CFilter().name("taylor PETER"), CSort()) == (std::list<CStudent>{
+                                                                   CStudent("Peter Taylor", CDate(1982, 2, 23), 2011)}));
+  assert(x0.suggest("taylor") == (std::set<std::string>{
+                                     "John Peter Taylor",
+                                     "John Taylor",
+                                     "Peter John Taylor",
+                                     "Peter Taylor"}));
+  assert(x0.suggest("  ") == (std::set<std::string>{}));
+  assert(x0.search(CFilter().bornAfter(CDate(1981, 7, 16)).bornBefore(CDate(1981, 8, 17)), CSort()) == (std::list<CStudent>{
+                                                                                                           CStudent("James Bond", CDate(1981, 8, 16), 2013),
+                                                                                                           CStudent("James Bond", CDate(1981, 7, 17), 2013)}));
+  assert(x0.search(CFilter().enrolledAfter(2013).name("peter john taylor"), CSort().addKey(ESortKey::ENROLL_YEAR, true)) == (std::list<CStudent>{
+                                                                                                                               CStudent("John Peter Taylor", CDate(1983, 7, 13), 2014),
+                                                                                                                               CStudent("Peter John Taylor", CDate(1984, 1, 17), 2017)}));
+  assert(x0.search(CFilter().enrolledAfter(2013).enrolledBefore(2014), CSort()) == (std::list<CStudent>{}));
+  assert(x0.search(CFilter().bornAfter(CDate(1990, 1, 1)).bornBefore(CDate(1980, 1, 1)), CSort()) == (std::list<CStudent>{}));
+  assert(x0.search(CFilter(), CSort().addKey(ESortKey::BIRTH_DATE, false).addKey(ESortKey::NAME, true), 3) == (std::list<CStudent>{
+                                                                                                                 CStudent("Peter John Taylor", CDate(1984, 1, 17), 2017),
+                                                                                                                 CStudent("John Peter Taylor", CDate(1983, 7, 13), 2014),
+                                                                                                                 CStudent("James Bond", CDate(1982, 7, 16), 2013)}));
+  assert(x0.search(CFilter().name("james bond"), CSort().addKey(ESortKey::ENROLL_YEAR, true), 2) == (std::list<CStudent>{
+                                                                                                         CStudent("James Bond", CDate(1981, 7, 16), 2012),
+                                                                                                         CStudent("James Bond", CDate(1982, 7, 16), 2013)}));
+  assert(x0.search(CFilter(), CSort().addKey(ESortKey::NAME, true), 1) == (std::list<CStudent>{
+                                                                              CStudent("Bond James", CDate(1981, 7, 16), 2013)}));
+  assert(x0.search(CFilter(), CSort(), 0).empty());
+
+  auto cursor = x0.searchCursor(CFilter().bornBefore(CDate(1983, 1, 1)), CSort().addKey(ESortKey::ENROLL_YEAR, false).addKey(ESortKey::NAME, true), 3);
+  assert(cursor.next() == (std::list<CStudent>{
+                              CStudent("Bond James", CDate(1981, 7, 16), 2013),
+                              CStudent("James Bond", CDate(1982, 7, 16), 2013),
+                              CStudent("James Bond", CDate(1981, 8, 16), 2013)}));
+  std::string position = cursor.continuation();
+  assert(cursor.next() == (std::list<CStudent>{
+                              CStudent("James Bond", CDate(1981, 7, 17), 2013),
+                              CStudent("James Bond", CDate(1981, 7, 16), 2012),
+                              CStudent("John Taylor", CDate(1981, 6, 30), 2012)}));
+  assert(!cursor.done());
+  assert(cursor.next() == (std::list<CStudent>{
+                              CStudent("Peter Taylor", CDate(1982, 2, 23), 2011)}));
+  assert(cursor.done() && cursor.next().empty());
+  // resuming after the last returned student left
+  assert(x0.delStudent(CStudent("James Bond", CDate(1981, 8, 16), 2013)));
+  auto resumed = x0.searchCursor(CFilter().bornBefore(CDate(1983, 1, 1)), CSort().addKey(ESortKey::ENROLL_YEAR, false).addKey(ESortKey::NAME, true), 2, position);
+  assert(resumed.next() == (std::list<CStudent>{
+                               CStudent("James Bond", CDate(1981, 7, 17), 2013),
+                               CStudent("James Bond", CDate(1981, 7, 16), 2012)}));
+  auto byName = x0.searchCursor(CFilter().name("james bond"), CSort().addKey(ESortKey::NAME, true).addKey(ESortKey::BIRTH_DATE, true), 3);
+  assert(byName.next().size() == 3 && byName.next().size() == 1 && byName.done());
+  try
+  {
+    x0.searchCursor(CFilter(), CSort(), 5, "garbage");
+    assert("Exception not thrown" == nullptr);
+  }
+  catch (const std::invalid_argument &e)
+  {
+  }
+
+  // enough deletes to compact the columns, with a cursor open across it
+  CStudyDept x1;
+  for (int i = 0; i < 3000; ++i)
+  {
+    assert(x1.addStudent(CStudent(i % 2 ? "Anna Smith" : "Bob Smith", CDate(1990 + i % 7, 1 + i % 12, 1 + i % 28), 2000 + i)));
+  }
+  auto churn = x1.searchCursor(CFilter().name("smith anna"), CSort(), 2);
+  assert(churn.next() == (std::list<CStudent>{
+                             CStudent("Anna Smith", CDate(1991, 2, 2), 2001),
+                             CStudent("Anna Smith", CDate(1993, 4, 4), 2003)}));
+  for (int i = 0; i < 2990; ++i)
+  {
+    assert(x1.delStudent(CStudent(i % 2 ? "Anna Smith" : "Bob Smith", CDate(1990 + i % 7, 1 + i % 12, 1 + i % 28), 2000 + i)));
+  }
+  assert(churn.next() == (std::list<CStudent>{
+                             CStudent("Anna Smith", CDate(1992, 4, 24), 4991),
+                             CStudent("Anna Smith", CDate(1994, 6, 26), 4993)}));
+  assert(x1.search(CFilter().enrolledAfter(4995), CSort().addKey(ESortKey::NAME, false)) == (std::list<CStudent>{
+                                                                                               CStudent("Bob Smith", CDate(1990, 9, 1), 4996),
+                                                                                               CStudent("Bob Smith", CDate(1992, 11, 3), 4998),
+                                                                                               CStudent("Anna Smith", CDate(1991, 10, 2), 4997),
+                                                                                               CStudent("Anna Smith", CDate(1993, 12, 4), 4999)}));
+  assert(x1.suggest("bob") == (std::set<std::string>{"Bob Smith"}));
+
+  // parallel scan gives the same result as the serial one
+  CStudyDept x2;
+  for (int i = 0; i < 5000; ++i)
+  {
+    assert(x2.addStudent(CStudent(i % 3 ? "Carl Jones" : "Dana Jones", CDate(1980 + i % 11, 1 + i % 12, 1 + i % 28), 2000 + i % 13)));
+  }
+  CSort byYear = CSort().addKey(ESortKey::ENROLL_YEAR, false).addKey(ESortKey::NAME, true);
+  x2.setScanWorkers(1);
+  std::list<CStudent> serial = x2.search(CFilter().name("carl jones").name("Dana JONES"), byYear);
+  std::list<CStudent> serialTop = x2.search(CFilter(), byYear, 300);
+  x2.setScanWorkers(4, 1000);
+  assert(x2.search(CFilter().name("carl jones").name("Dana JONES"), byYear) == serial && serial.size() == 5000);
+  assert(x2.search(CFilter(), byYear, 300) == serialTop);
+  assert(x2.search(CFilter(), CSort()).size() == 5000);
   return EXIT_SUCCESS;
 }
 #endif /* __PROGTEST__ */